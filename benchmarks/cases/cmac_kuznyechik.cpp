@@ -0,0 +1,63 @@
+/**
+ * @file cmac_kuznyechik.cpp
+ * @brief Benchmarks for Kuznyechik in CMAC mode of operation.
+ */
+
+#include "bench_common.hpp"
+
+
+namespace bench::cmac {
+
+/**
+ * @brief Message sizes to measure.
+ */
+inline constexpr std::size_t message_sizes[] = { 512, 4096 };
+
+}  // namespace bench::cmac
+
+
+BCMLIB_BENCHMARK(CmacKuznyechikDigestMany)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY internal_key;
+    cipher.initialize_encrypt_key(key, &internal_key);
+
+    CMAC_CONTEXT context;
+    cmac_context_init(&internal_key, &context, &cipher);
+
+    constexpr unsigned long messages = 64;
+
+    for (const auto size : bench::cmac::message_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks * messages), tags(messages);
+
+        const auto internal_in   = in.data()->bytes;
+        const auto internal_tags = tags.data()->bytes;
+
+        bench::details::Measure("cmac_digest_perform per message", size * messages, [&]() {
+            for (unsigned long message = 0; message < messages; ++message)
+            {
+                cmac_digest_perform(internal_in + message * size, blocks, &internal_key,
+                                    BCMLIB_CMAC_TAG_SIZE_128, internal_tags + message * 16, &cipher);
+            }
+        });
+
+        bench::details::Measure("cmac_digest_context per message", size * messages, [&]() {
+            for (unsigned long message = 0; message < messages; ++message)
+            {
+                cmac_digest_context(internal_in + message * size, blocks, &context,
+                                    BCMLIB_CMAC_TAG_SIZE_128, internal_tags + message * 16);
+            }
+        });
+
+        bench::details::Measure("cmac_digest_many", size * messages, [&]() {
+            cmac_digest_many(internal_in, messages, blocks, &context,
+                             BCMLIB_CMAC_TAG_SIZE_128, internal_tags);
+        });
+    }
+}
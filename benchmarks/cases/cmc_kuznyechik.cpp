@@ -0,0 +1,90 @@
+/**
+ * @file cmc_kuznyechik.cpp
+ * @brief Benchmarks for Kuznyechik in CMC mode of operation.
+ */
+
+#include "bench_common.hpp"
+
+
+namespace bench::cmc {
+
+/**
+ * @brief Sector sizes to measure.
+ */
+inline constexpr std::size_t sector_sizes[] = { 512, 4096 };
+
+
+/**
+ * @brief Large data unit sizes to measure (from L1-resident to DRAM-resident).
+ */
+inline constexpr std::size_t unit_sizes[] = { 4096, 16384, 65536, 262144, 1048576, 4194304 };
+
+}  // namespace bench::cmc
+
+
+BCMLIB_BENCHMARK(CmcKuznyechikEncryptSectors)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY data_key;
+    KEY tweak_key;
+
+    cipher.initialize_encrypt_key(key, &data_key);
+    cipher.initialize_encrypt_key(key, &tweak_key);
+
+    constexpr unsigned long sectors = 32;
+
+    for (const auto size : bench::cmc::sector_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks * sectors), out(blocks * sectors);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("cmc_encrypt_perform per sector", size * sectors, [&]() {
+            for (unsigned long sector = 0; sector < sectors; ++sector)
+            {
+                cmc_encrypt_perform(sector, internal_in + sector * size, blocks, &data_key,
+                                    &tweak_key, internal_out + sector * size, &cipher);
+            }
+        });
+
+        bench::details::Measure("cmc_encrypt_sectors_perform", size * sectors, [&]() {
+            cmc_encrypt_sectors_perform(0, sectors, internal_in, blocks, &data_key,
+                                        &tweak_key, internal_out, &cipher);
+        });
+    }
+}
+
+
+BCMLIB_BENCHMARK(CmcKuznyechikEncryptLarge)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY data_key;
+    KEY tweak_key;
+
+    cipher.initialize_encrypt_key(key, &data_key);
+    cipher.initialize_encrypt_key(key, &tweak_key);
+
+    for (const auto size : bench::cmc::unit_sizes)
+    {
+        const auto blocks = static_cast<unsigned long long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks), out(blocks);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("cmc_encrypt_large_perform", size, [&]() {
+            cmc_encrypt_large_perform(0, internal_in, blocks, &data_key,
+                                      &tweak_key, internal_out, &cipher);
+        });
+    }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file dec_kuznyechik.cpp
+ * @brief Benchmarks for Kuznyechik in DEC mode of operation.
+ */
+
+#include "bench_common.hpp"
+
+
+namespace bench::dec {
+
+/**
+ * @brief Sector sizes to measure.
+ */
+inline constexpr std::size_t unit_sizes[] = { 512, 4096, 64 * 1024 };
+
+}  // namespace bench::dec
+
+
+BCMLIB_BENCHMARK(DecKuznyechikEncrypt)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(key, &master_key);
+
+    constexpr unsigned long entries = 16;
+
+    constexpr std::size_t block_size = sizeof(bench::details::Block);
+
+    bench::details::DataUnit partition_storage((dec_key_cache_storage_size(entries) + block_size - 1) / block_size);
+    bench::details::DataUnit sector_storage((dec_key_cache_storage_size(entries) + block_size - 1) / block_size);
+
+    DEC_KEY_CACHE partition_keys;
+    DEC_KEY_CACHE sector_keys;
+
+    dec_key_cache_init(&partition_keys, partition_storage.data(), entries);
+    dec_key_cache_init(&sector_keys, sector_storage.data(), entries);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+    context.partition_keys = &partition_keys;
+    context.sector_keys    = &sector_keys;
+
+    for (const auto size : bench::dec::unit_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks), out(blocks);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("dec_encrypt_perform", size, [&]() {
+            dec_encrypt_perform(1, 1, 0, 1, internal_in, blocks,
+                                &master_key, internal_out, &cipher);
+        });
+
+        //
+        // Sector key is cached, so only keystream is measured here
+        //
+
+        bench::details::Measure("dec_encrypt_context (cached keys)", size, [&]() {
+            dec_encrypt_context(1, 1, 0, 1, internal_in, blocks,
+                                &context, internal_out);
+        });
+    }
+}
+
+
+BCMLIB_BENCHMARK(DecKuznyechikEncryptSectors)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(key, &master_key);
+
+    constexpr unsigned long sectors = 256;
+
+    std::vector<unsigned long long> sector_counters(sectors, 1);
+
+    for (const auto size : bench::dec::unit_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks * sectors), out(blocks * sectors);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("dec_encrypt_perform per sector", size * sectors, [&]() {
+            for (unsigned long sector = 0; sector < sectors; ++sector)
+            {
+                dec_encrypt_perform(1, 1, sector, sector_counters[sector], internal_in + sector * size,
+                                    blocks, &master_key, internal_out + sector * size, &cipher);
+            }
+        });
+
+        bench::details::Measure("dec_encrypt_sectors_perform", size * sectors, [&]() {
+            dec_encrypt_sectors_perform(1, 1, 0, sectors, sector_counters.data(), internal_in,
+                                        blocks, &master_key, internal_out, &cipher);
+        });
+    }
+}
+
+
+BCMLIB_BENCHMARK(DecKuznyechikMount)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(key, &master_key);
+
+    //
+    // The first sector of each partition is encrypted without caches,
+    // so every partition key is either derived (cold mount) or loaded
+    // from the store filled before (warm mount)
+    //
+
+    constexpr unsigned long long partitions = 64;
+    constexpr std::size_t block_size        = sizeof(bench::details::Block);
+
+    const auto size = dec_key_store_region_size(partitions);
+    bench::details::DataUnit region((size + block_size - 1) / block_size);
+
+    KEY keys[BCMLIB_DEC_KEY_STORE_KEYS];
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+
+    DEC_KEY_STORE store;
+    dec_key_store_open(region.data(), size, keys, &context, &store);
+
+    constexpr unsigned long blocks = 2;
+    bench::details::DataUnit in(blocks), out(blocks);
+
+    const auto internal_in  = in.data()->bytes;
+    const auto internal_out = out.data()->bytes;
+
+    const auto mount = [&]() {
+        for (unsigned long long partition = 0; partition < partitions; ++partition)
+        {
+            dec_encrypt_context(partition, 1, 0, 1, internal_in, blocks, &context, internal_out);
+        }
+    };
+
+    bench::details::Measure("cold mount (keys derived)", partitions * blocks * block_size, mount);
+
+    context.key_store = &store;
+    mount();
+
+    bench::details::Measure("warm mount (keys loaded from store)", partitions * blocks * block_size, mount);
+
+    dec_key_store_close(&store);
+}
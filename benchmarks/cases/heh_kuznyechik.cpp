@@ -0,0 +1,87 @@
+/**
+ * @file heh_kuznyechik.cpp
+ * @brief Benchmarks for Kuznyechik in HEH mode of operation.
+ */
+
+#include "bench_common.hpp"
+
+
+namespace bench::heh {
+
+/**
+ * @brief Sector sizes to measure.
+ */
+inline constexpr std::size_t sector_sizes[] = { 512, 4096 };
+
+
+/**
+ * @brief Large data unit sizes to measure (from L1-resident to DRAM-resident).
+ */
+inline constexpr std::size_t unit_sizes[] = { 4096, 16384, 65536, 262144, 1048576, 4194304 };
+
+}  // namespace bench::heh
+
+
+BCMLIB_BENCHMARK(HehKuznyechikEncryptSectors)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY internal_key;
+    cipher.initialize_encrypt_key(key, &internal_key);
+
+    constexpr unsigned long sectors = 32;
+
+    for (const auto size : bench::heh::sector_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks * sectors), out(blocks * sectors);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("heh_encrypt_perform per sector", size * sectors, [&]() {
+            for (unsigned long sector = 0; sector < sectors; ++sector)
+            {
+                heh_encrypt_perform(sector, internal_in + sector * size, blocks,
+                                    &internal_key, internal_out + sector * size, &cipher);
+            }
+        });
+
+        bench::details::Measure("heh_encrypt_sectors_perform", size * sectors, [&]() {
+            heh_encrypt_sectors_perform(0, sectors, internal_in, blocks, &internal_key,
+                                        internal_out, &cipher);
+        });
+    }
+}
+
+
+BCMLIB_BENCHMARK(HehKuznyechikEncryptLarge)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY internal_key;
+    cipher.initialize_encrypt_key(key, &internal_key);
+
+    for (const auto size : bench::heh::unit_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks), out(blocks);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("heh_encrypt_perform", size, [&]() {
+            heh_encrypt_perform(0, internal_in, blocks, &internal_key, internal_out, &cipher);
+        });
+
+        bench::details::Measure("heh_encrypt_large_perform", size, [&]() {
+            heh_encrypt_large_perform(0, internal_in, blocks, &internal_key, internal_out, &cipher);
+        });
+    }
+}
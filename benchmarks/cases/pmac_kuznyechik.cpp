@@ -0,0 +1,48 @@
+/**
+ * @file pmac_kuznyechik.cpp
+ * @brief Benchmarks for Kuznyechik in PMAC mode of operation compared to CMAC.
+ */
+
+#include "bench_common.hpp"
+
+
+namespace bench::pmac {
+
+/**
+ * @brief Message sizes to measure.
+ */
+inline constexpr std::size_t message_sizes[] = { 512, 4096, 64 * 1024, 1024 * 1024 };
+
+}  // namespace bench::pmac
+
+
+BCMLIB_BENCHMARK(PmacKuznyechikDigest)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY internal_key;
+    cipher.initialize_encrypt_key(key, &internal_key);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char tag[16];
+
+    for (const auto size : bench::pmac::message_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks);
+
+        const auto internal_in = in.data()->bytes;
+
+        bench::details::Measure("cmac_digest_perform", size, [&]() {
+            cmac_digest_perform(internal_in, blocks, &internal_key,
+                                BCMLIB_CMAC_TAG_SIZE_128, tag, &cipher);
+        });
+
+        bench::details::Measure("pmac_digest_perform", size, [&]() {
+            pmac_digest_perform(internal_in, blocks, &internal_key,
+                                BCMLIB_PMAC_TAG_SIZE_128, tag, &cipher);
+        });
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file xts_kuznyechik.cpp
+ * @brief Benchmarks for Kuznyechik in XTS mode of operation.
+ */
+
+#include "bench_common.hpp"
+#include "galoislib.h"
+
+#include <immintrin.h>
+
+
+namespace bench::xts {
+
+/**
+ * @brief Sector sizes to measure.
+ */
+inline constexpr std::size_t sector_sizes[] = { 512, 4096 };
+
+
+/**
+ * @brief Straightforward XTS encryption: one cipher call per loop 
+ *        iteration, tweak is updated after each block.
+ */
+void SerialEncrypt(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                   const KEY* data_key, const KEY* tweak_key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i temporary;
+    __m128i tweak = _mm_set_epi64x(0, static_cast<long long>(sector));
+
+    cipher->encrypt_block(tweak, tweak_key, &tweak);
+
+    for (unsigned long block = 0; block < blocks; ++block, in += cipher->block_size, out += cipher->block_size)
+    {
+        temporary = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+        temporary = _mm_xor_si128(temporary, tweak);
+        cipher->encrypt_block(temporary, data_key, &temporary);
+        temporary = _mm_xor_si128(temporary, tweak);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), temporary);
+
+        tweak = gf128_multiply_primitive(tweak);
+    }
+}
+
+}  // namespace bench::xts
+
+
+BCMLIB_BENCHMARK(XtsKuznyechikEncrypt)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY data_key;
+    KEY tweak_key;
+
+    cipher.initialize_encrypt_key(key, &data_key);
+    cipher.initialize_encrypt_key(key, &tweak_key);
+
+    for (const auto size : bench::xts::sector_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks), out(blocks);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("serial", size, [&]() {
+            bench::xts::SerialEncrypt(1, internal_in, blocks, &data_key, &tweak_key, internal_out, &cipher);
+        });
+
+        bench::details::Measure("xts_encrypt_perform", size, [&]() {
+            xts_encrypt_perform(1, internal_in, blocks, &data_key, &tweak_key, internal_out, &cipher);
+        });
+    }
+}
+
+
+BCMLIB_BENCHMARK(XtsKuznyechikEncryptSectors)
+{
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_BENCH_ALIGN16 unsigned char key[32] = { 0x11 };
+
+    KEY data_key;
+    KEY tweak_key;
+
+    cipher.initialize_encrypt_key(key, &data_key);
+    cipher.initialize_encrypt_key(key, &tweak_key);
+
+    constexpr unsigned long sectors = 32;
+
+    for (const auto size : bench::xts::sector_sizes)
+    {
+        const auto blocks = static_cast<unsigned long>(size / cipher.block_size);
+        bench::details::DataUnit in(blocks * sectors), out(blocks * sectors);
+
+        const auto internal_in  = in.data()->bytes;
+        const auto internal_out = out.data()->bytes;
+
+        bench::details::Measure("xts_encrypt_perform per sector", size * sectors, [&]() {
+            for (unsigned long sector = 0; sector < sectors; ++sector)
+            {
+                xts_encrypt_perform(sector, internal_in + sector * size, blocks, &data_key,
+                                    &tweak_key, internal_out + sector * size, &cipher);
+            }
+        });
+
+        bench::details::Measure("xts_encrypt_sectors_perform", size * sectors, [&]() {
+            xts_encrypt_sectors_perform(0, sectors, internal_in, blocks, &data_key,
+                                        &tweak_key, internal_out, &cipher);
+        });
+    }
+}
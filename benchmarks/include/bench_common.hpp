@@ -0,0 +1,21 @@
+/**
+ * @file bench_common.hpp
+ * @brief Common header for all benchmarks.
+ */
+
+#pragma once
+
+
+//
+// bcm-lib
+//
+
+#include "bclib.h"
+#include "bcmlib.h"
+
+
+//
+// Helpers
+//
+
+#include "bench_utils.hpp"
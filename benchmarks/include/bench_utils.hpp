@@ -0,0 +1,139 @@
+/**
+ * @file bench_utils.hpp
+ * @brief Some helpers for benchmarks.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <vector>
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#elif defined(__GNUC__)
+#   include <x86intrin.h>
+#else
+#   error Unsupported target for now
+#endif
+
+
+//
+// Necessary helper macro
+//
+
+#if defined(_MSC_VER)
+#   define BCMLIB_BENCH_ALIGN16 __declspec(align(16))
+#elif defined(__GNUC__)
+#   define BCMLIB_BENCH_ALIGN16 __attribute__ ((aligned(16)))
+#else
+#   error Unsupported target for now
+#endif
+
+
+/**
+ * @brief Declares a benchmark. It is registered automatically
+ *        and is run by benchmarks' `main` function.
+ */
+#define BCMLIB_BENCHMARK(name)                                                              \
+    static void name();                                                                     \
+    static const bool name##_registered = ::bench::details::Register(#name, name);          \
+    static void name()
+
+
+namespace bench::details {
+
+/**
+ * @brief 128-bit block, that can be stored in standard containers.
+ */
+struct alignas(16) Block
+{
+    unsigned char bytes[16];
+};
+
+
+/**
+ * @brief Buffer of blocks (data unit).
+ */
+using DataUnit = std::vector<Block>;
+
+
+/**
+ * @brief Benchmark routine.
+ */
+using Routine = void (*)();
+
+
+/**
+ * @brief Registered benchmark.
+ */
+struct Benchmark
+{
+    const char* name;
+    Routine routine;
+};
+
+
+/**
+ * @brief Returns list of all registered benchmarks.
+ */
+inline std::vector<Benchmark>& Registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+
+/**
+ * @brief Registers a benchmark.
+ */
+inline bool Register(const char* name, Routine routine)
+{
+    Registry().push_back({ name, routine });
+    return true;
+}
+
+
+/**
+ * @brief Measures throughput of a function, that processes `bytes` bytes
+ *        per call, and prints it in a row of a report.
+ */
+template<typename Fn>
+void Measure(const char* label, std::size_t bytes, Fn&& fn)
+{
+    using clock = std::chrono::steady_clock;
+
+    //
+    // Warm up caches and branch predictors, then repeat
+    // measured function for a fixed amount of data
+    //
+
+    constexpr std::size_t warmup_iterations = 16;
+    constexpr std::size_t total_bytes       = 64ull << 20;
+
+    const std::size_t iterations = (total_bytes + bytes - 1) / bytes;
+
+    for (std::size_t idx = 0; idx < warmup_iterations; ++idx)
+    {
+        fn();
+    }
+
+    const auto start_time   = clock::now();
+    const auto start_cycles = __rdtsc();
+
+    for (std::size_t idx = 0; idx < iterations; ++idx)
+    {
+        fn();
+    }
+
+    const auto cycles  = __rdtsc() - start_cycles;
+    const auto elapsed = std::chrono::duration<double>(clock::now() - start_time).count();
+
+    const double processed = static_cast<double>(bytes) * static_cast<double>(iterations);
+
+    std::printf("  %-40s %10zu B %10.2f MiB/s %8.3f B/cycle\n", label, bytes,
+                processed / elapsed / (1 << 20), processed / static_cast<double>(cycles));
+}
+
+}  // namespace bench::details
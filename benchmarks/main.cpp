@@ -0,0 +1,31 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of benchmarks: runs all registered ones.
+ */
+
+#include "bench_common.hpp"
+
+#include <cstring>
+
+
+int main(int argc, char** argv)
+{
+    //
+    // Optional argument is a substring of benchmarks' names to run
+    //
+
+    const char* filter = (argc > 1) ? argv[1] : "";
+
+    for (const auto& benchmark : bench::details::Registry())
+    {
+        if (!std::strstr(benchmark.name, filter))
+        {
+            continue;
+        }
+
+        std::printf("%s\n", benchmark.name);
+        benchmark.routine();
+    }
+
+    return 0;
+}
@@ -15,6 +15,7 @@
 #include "modes/heh/heh.h"
 #include "modes/xts/xts.h"
 #include "modes/cmac/cmac.h"
+#include "modes/pmac/pmac.h"
 #include "modes/dec/dec.h"
 
 
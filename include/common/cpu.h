@@ -0,0 +1,25 @@
+/**
+ * @file cpu.h
+ * @brief Runtime detection of CPU features.
+ */
+
+#ifndef BCMLIB_CPU_INCLUDED
+#define BCMLIB_CPU_INCLUDED
+
+
+/**
+ * @brief CPU features, that are used by optimized code paths.
+ */
+#define BCMLIB_CPU_AVX2_VPCLMULQDQ      (0x00000001)  /**< AVX2 and 256-bit carry-less multiplication */
+#define BCMLIB_CPU_AVX512_VPCLMULQDQ    (0x00000002)  /**< AVX-512 and 512-bit carry-less multiplication */
+#define BCMLIB_CPU_PCLMULQDQ            (0x00000004)  /**< 128-bit carry-less multiplication */
+
+
+/**
+ * @brief Returns a set of `BCMLIB_CPU_*` flags supported by current CPU and OS.
+ *        The value is calculated once and cached.
+ */
+unsigned long bcmlib_cpu_features(void);
+
+
+#endif  // !BCMLIB_CPU_INCLUDED
@@ -0,0 +1,48 @@
+/**
+ * @file executor.h
+ * @brief Interface of an executor used to run independent tasks in parallel.
+ */
+
+#ifndef BCMLIB_EXECUTOR_INCLUDED
+#define BCMLIB_EXECUTOR_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+
+/**
+ * @brief Routine of a single task.
+ * 
+ * @param context context shared by all tasks
+ * @param task index of the task to run
+ */
+typedef void (*bcmlib_task_routine)(void* context, unsigned long task);
+
+
+/**
+ * @brief Executor interface.
+ * 
+ * bcm-lib never creates threads by itself (it can be built for kernel mode,
+ * where threading is up to the driver), so callers provide an executor,
+ * that runs independent tasks on their own worker threads.
+ */
+typedef struct tagBCMLIB_EXECUTOR
+{
+    unsigned long concurrency; /**< Maximum number of tasks, that can run simultaneously */
+
+    void* user_context; /**< Arbitrary user-defined context, passed to `run` */
+
+    /**
+     * Runs tasks with indices [0, tasks) (possibly in parallel) and
+     * returns once all of them are complete.
+     */
+    void (*run)(void* user_context, bcmlib_task_routine routine, void* context, unsigned long tasks);
+} BCMLIB_EXECUTOR;
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !BCMLIB_EXECUTOR_INCLUDED
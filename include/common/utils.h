@@ -31,6 +31,39 @@
 #endif
 
 
+/**
+ * @brief Enables instruction set extensions for a single function.
+ *        MSVC allows intrinsics of any extension without this.
+ */
+#if defined(_MSC_VER)
+#   define BCMLIB_TARGET_PCLMULQDQ
+#   define BCMLIB_TARGET_AVX2_VPCLMULQDQ
+#   define BCMLIB_TARGET_AVX512_VPCLMULQDQ
+#elif defined(__GNUC__)
+#   define BCMLIB_TARGET_PCLMULQDQ __attribute__((target("pclmul")))
+#   define BCMLIB_TARGET_AVX2_VPCLMULQDQ __attribute__((target("avx2,vpclmulqdq")))
+#   define BCMLIB_TARGET_AVX512_VPCLMULQDQ __attribute__((target("avx512f,vpclmulqdq")))
+#else
+#   error Unsupported target for now
+#endif
+
+
+/**
+ * @brief Interlocked exchange (with acquire semantics) and
+ *        release store of a `long` value. Used by spinlocks.
+ */
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#   define BCMLIB_INTERLOCKED_EXCHANGE(target, value) _InterlockedExchange((volatile long*)(target), (value))
+#   define BCMLIB_INTERLOCKED_RELEASE(target, value) ((void)_InterlockedExchange((volatile long*)(target), (value)))
+#elif defined(__GNUC__)
+#   define BCMLIB_INTERLOCKED_EXCHANGE(target, value) __atomic_exchange_n((target), (value), __ATOMIC_ACQUIRE)
+#   define BCMLIB_INTERLOCKED_RELEASE(target, value) __atomic_store_n((target), (value), __ATOMIC_RELEASE)
+#else
+#   error Unsupported target for now
+#endif
+
+
 /**
  * @brief Static assertion for C language (prior to C11).
  */
@@ -73,4 +106,23 @@
 long long bcmlib_swap_endian_ll(long long value);
 
 
+/**
+ * @brief Acquires a spinlock. Lock is a `long` value initialized with 0.
+ */
+void bcmlib_spinlock_acquire(volatile long* lock);
+
+
+/**
+ * @brief Releases a spinlock acquired by `bcmlib_spinlock_acquire`.
+ */
+void bcmlib_spinlock_release(volatile long* lock);
+
+
+/**
+ * @brief Fills memory with zeros. Unlike `memset`, it is not
+ *        optimized out, so it is used to wipe keys.
+ */
+void bcmlib_secure_zero(void* data, unsigned long size);
+
+
 #endif  // !BCMLIB_UTILS_INCLUDED
@@ -41,6 +41,33 @@ typedef enum tag_cmac_verify_result
 } cmac_verify_result;
 
 
+/**
+ * @brief Keyed CMAC context. Subkeys depend on a key only, so they are
+ *        derived once by `cmac_context_init` and reused by each call.
+ *        Key and cipher MUST outlive the context.
+ */
+typedef struct tagCMAC_CONTEXT
+{
+    const KEY* key;               /**< MAC key (initialized for encryption) */
+    const BLOCK_CIPHER* cipher;   /**< Cipher interface */
+    unsigned char subkey1[16];    /**< Subkey K1 */
+    unsigned char subkey2[16];    /**< Subkey K2 */
+} CMAC_CONTEXT;
+
+
+/**
+ * @brief Streaming CMAC state. Data is passed by `cmac_update`
+ *        in chunks of arbitrary length.
+ */
+typedef struct tagCMAC_STATE
+{
+    const CMAC_CONTEXT* context;  /**< Keyed CMAC context */
+    unsigned char chain[16];      /**< Current value of CBC chain */
+    unsigned char buffer[16];     /**< Pending (possibly the last) block */
+    unsigned long buffered;       /**< Number of bytes in `buffer` */
+} CMAC_STATE;
+
+
 /**
  * @brief Computes CMAC using 128-bit block cipher.
  *        Tag is `significan_bits` bit long and is stored in most significant
@@ -96,6 +123,118 @@ cmac_verify_result cmac_verify_perform(const unsigned char* in, unsigned long bl
                                        unsigned long significant_bits, const BLOCK_CIPHER* cipher);
 
 
+/**
+ * @brief Initializes keyed CMAC context: derives subkeys K1 and K2.
+ *
+ * @param key MAC key (initialized for encryption)
+ * @param context context to initialize
+ * @param cipher cipher interface to use
+ */
+void cmac_context_init(const KEY* key, CMAC_CONTEXT* context, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Computes CMAC using keyed context. Result is the same as of `cmac_digest`.
+ * 
+ * @param in set of several full 128-bit blocks to compute MAC for
+ * @param blocks number of blocks in data
+ * @param context keyed CMAC context
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_CMAC_TAG_SIZE_*` constants
+ * @param out pointer to a 128-bit value, that receives the value of MAC 
+ */
+void cmac_digest_context(const unsigned char* in, unsigned long blocks, const CMAC_CONTEXT* context,
+                         unsigned long significant_bits, unsigned char* out);
+
+
+/**
+ * @brief Verifies MAC using keyed context. Result is the same as of `cmac_verify`.
+ *
+ * @param in set of several full 128-bit blocks to verify MAC for
+ * @param blocks number of blocks in data
+ * @param context keyed CMAC context
+ * @param tag pointer to a 128-bit value, that contains the value of MAC
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_CMAC_TAG_SIZE_*` constants
+ * 
+ * @return 'cmac_valid' if MAC is correct and 'cmac_invalid' -- otherwise
+ */
+cmac_verify_result cmac_verify_context(const unsigned char* in, unsigned long blocks, const CMAC_CONTEXT* context,
+                                       const unsigned char* tag, unsigned long significant_bits);
+
+
+/**
+ * @brief Computes CMAC of several messages of equal length at once.
+ *        CBC chains of several messages are advanced in lockstep.
+ * 
+ * @param in messages, each one is `blocks` full 128-bit blocks, one after another
+ * @param messages number of messages
+ * @param blocks number of blocks in each message
+ * @param context keyed CMAC context
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_CMAC_TAG_SIZE_*` constants
+ * @param out array of `messages` 128-bit values, that receives MACs
+ */
+void cmac_digest_many(const unsigned char* in, unsigned long messages, unsigned long blocks,
+                      const CMAC_CONTEXT* context, unsigned long significant_bits, unsigned char* out);
+
+
+/**
+ * @brief Verifies MACs of several messages of equal length at once.
+ *        Tags are compared in constant time.
+ * 
+ * @param in messages, each one is `blocks` full 128-bit blocks, one after another
+ * @param messages number of messages
+ * @param blocks number of blocks in each message
+ * @param context keyed CMAC context
+ * @param tags array of `messages` 128-bit values, that contain MACs
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_CMAC_TAG_SIZE_*` constants
+ * @param results bitmap of `(messages + 7) / 8` bytes: bit `i % 8` of byte `i / 8`
+ *                receives verification result of i-th message (0 is 'cmac_valid'
+ *                and 1 is 'cmac_invalid')
+ * 
+ * @return 'cmac_valid' if all MACs are correct and 'cmac_invalid' -- otherwise
+ */
+cmac_verify_result cmac_verify_many(const unsigned char* in, unsigned long messages, unsigned long blocks,
+                                    const CMAC_CONTEXT* context, const unsigned char* tags,
+                                    unsigned long significant_bits, unsigned char* results);
+
+
+/**
+ * @brief Starts streaming CMAC computation.
+ * 
+ * @param context keyed CMAC context (MUST outlive the state)
+ * @param state state to initialize
+ */
+void cmac_init(const CMAC_CONTEXT* context, CMAC_STATE* state);
+
+
+/**
+ * @brief Passes next chunk of data to streaming CMAC computation.
+ *        Full blocks are processed directly from `in`, only
+ *        a tail of up to one block is copied into the state.
+ * 
+ * @param state streaming CMAC state
+ * @param in chunk of data
+ * @param size size of the chunk in bytes (any)
+ */
+void cmac_update(CMAC_STATE* state, const unsigned char* in, unsigned long size);
+
+
+/**
+ * @brief Finishes streaming CMAC computation. If the last block is
+ *        incomplete, it is padded and subkey K2 is used. For data of
+ *        full blocks result is the same as of `cmac_digest`.
+ * 
+ * @param state streaming CMAC state (it is reset after the call)
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_CMAC_TAG_SIZE_*` constants
+ * @param out pointer to a 128-bit value, that receives the value of MAC 
+ */
+void cmac_final(CMAC_STATE* state, unsigned long significant_bits, unsigned char* out);
+
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
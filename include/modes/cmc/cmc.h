@@ -73,6 +73,122 @@ void cmc_decrypt_perform(unsigned long long tweak, const unsigned char* in, unsi
                          unsigned char* out, const BLOCK_CIPHER* cipher);
 
 
+/**
+ * @brief Encrypts a large data unit (64 KiB and more) in CMC mode of operation.
+ * 
+ * Result is the same as of `cmc_encrypt`, but number of blocks is 64-bit.
+ * Passes over data go in opposite directions, so each pass starts with
+ * blocks, that are still in cache after the previous one.
+ *
+ * @param tweak tweak used for encryption
+ * @param in data of the unit
+ * @param blocks number of blocks in the unit
+ * @param data_key key used to encrypt data
+ * @param tweak_key key used to encrypt tweak
+ * @param out ciphertext
+ * @param cipher cipher interface to use
+ */
+void cmc_encrypt_large(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                       const unsigned char* data_key, const unsigned char* tweak_key,
+                       unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual encryption of a large data unit in CMC mode. 
+ *        This function exists for testing purposes. 
+ */
+void cmc_encrypt_large_perform(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                               const KEY* data_key, const KEY* tweak_key,
+                               unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts a large data unit (64 KiB and more) in CMC mode of operation.
+ * 
+ * Result is the same as of `cmc_decrypt`, but number of blocks is 64-bit.
+ *
+ * @param tweak tweak used for decryption
+ * @param in encrypted data of the unit
+ * @param blocks number of blocks in the unit
+ * @param data_key key used to decrypt data
+ * @param tweak_key key used to encrypt tweak
+ * @param out plaintext
+ * @param cipher cipher interface to use
+ */
+void cmc_decrypt_large(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                       const unsigned char* data_key, const unsigned char* tweak_key,
+                       unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual decryption of a large data unit in CMC mode. 
+ *        This function exists for testing purposes. 
+ */
+void cmc_decrypt_large_perform(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                               const KEY* data_key, const KEY* tweak_key,
+                               unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Encrypts several consecutive sectors in CMC mode of operation.
+ * 
+ * Result is the same as if `cmc_encrypt` was called for each sector with
+ * tweaks `first_tweak`, `first_tweak + 1` and so on, but CBC chains of
+ * several sectors are advanced in lockstep.
+ *
+ * @param first_tweak tweak of the first sector
+ * @param sectors number of sectors to encrypt
+ * @param in data of the sectors
+ * @param blocks number of blocks in each sector
+ * @param data_key key used to encrypt data
+ * @param tweak_key key used to encrypt tweak
+ * @param out ciphertext
+ * @param cipher cipher interface to use
+ */
+void cmc_encrypt_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual encryption of several sectors in CMC mode. 
+ *        This function exists for testing purposes. 
+ */
+void cmc_encrypt_sectors_perform(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts several consecutive sectors in CMC mode of operation.
+ * 
+ * Result is the same as if `cmc_decrypt` was called for each sector with
+ * tweaks `first_tweak`, `first_tweak + 1` and so on, but CBC chains of
+ * several sectors are advanced in lockstep.
+ *
+ * @param first_tweak tweak of the first sector
+ * @param sectors number of sectors to decrypt
+ * @param in encrypted data of the sectors
+ * @param blocks number of blocks in each sector
+ * @param data_key key used to decrypt data
+ * @param tweak_key key used to encrypt tweak
+ * @param out plaintext
+ * @param cipher cipher interface to use
+ */
+void cmc_decrypt_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual decryption of several sectors in CMC mode. 
+ *        This function exists for testing purposes. 
+ */
+void cmc_decrypt_sectors_perform(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
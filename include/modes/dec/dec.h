@@ -23,6 +23,182 @@ typedef struct tagBLOCK_CIPHER BLOCK_CIPHER;
 typedef struct tagKEY KEY;
 
 
+/**
+ * @brief Bounded thread-safe cache of expanded keys derived by DEC.
+ *        Storage for entries is provided by a caller (see
+ *        `dec_key_cache_storage_size`), the library never allocates it.
+ */
+typedef struct tagDEC_KEY_CACHE
+{
+    volatile long lock;        /**< Spinlock, that guards entries */
+    unsigned long sets;        /**< Number of sets of entries (0 disables the cache) */
+    unsigned long long clock;  /**< Logical time of the last access */
+    unsigned long long hits;   /**< Number of successful lookups */
+    unsigned long long misses; /**< Number of failed lookups */
+    void* entries;             /**< Caller-provided storage for entries */
+} DEC_KEY_CACHE;
+
+
+/**
+ * @brief Bounded thread-safe cache of prefetched keystreams (gamma) of
+ *        whole sectors. Storage is provided by a caller, its size is a
+ *        memory budget of the cache. Keystreams are wiped, when they are
+ *        consumed or evicted.
+ */
+typedef struct tagDEC_KEYSTREAM_CACHE
+{
+    volatile long lock;        /**< Spinlock, that guards slots */
+    unsigned long slots;       /**< Number of keystreams, that fit into the budget */
+    unsigned long blocks;      /**< Number of blocks in a sector */
+    unsigned long long clock;  /**< Logical time of the last insertion */
+    unsigned long long hits;   /**< Number of sectors processed with prefetched keystream */
+    unsigned long long misses; /**< Number of sectors processed without prefetched keystream */
+    void* storage;             /**< Caller-provided storage for keystreams */
+} DEC_KEYSTREAM_CACHE;
+
+
+/**
+ * @brief Maximal size of a key (in bytes) supported by derived-key store.
+ */
+#define BCMLIB_DEC_KEY_STORE_MAX_KEY_SIZE (32)
+
+
+/**
+ * @brief Number of expanded keys, that protect derived-key store.
+ */
+#define BCMLIB_DEC_KEY_STORE_KEYS (2)
+
+
+/**
+ * @brief Enumeration, that contains a set of possible
+ *        results of derived-key store opening
+ */
+typedef enum tag_dec_key_store_result
+{
+    dec_key_store_ok,      /**< Store is opened (and formatted, if region was empty) */
+    dec_key_store_invalid, /**< Region is too small, has unsupported version or belongs to another master key */
+} dec_key_store_result;
+
+
+/**
+ * @brief Persistent store of partition keys over a region mapped by a caller
+ *        (e.g. a memory-mapped file). Keys are stored wrapped under keys
+ *        derived from master key, so the region does not need protection
+ *        of its own. Library never flushes the region, it is up to caller.
+ *        Keys, that protect the store, are derived and expanded once, when
+ *        the store is opened. Their storage MUST outlive the store.
+ */
+typedef struct tagDEC_KEY_STORE
+{
+    volatile long lock;         /**< Spinlock, that guards entries */
+    unsigned long long entries; /**< Number of entries in the region */
+    void* region;               /**< Caller-mapped region */
+    KEY* keys;                  /**< Expanded wrapping and MAC keys */
+    unsigned char hash_key[16]; /**< Key of polynomial hash of entries */
+} DEC_KEY_STORE;
+
+
+/**
+ * @brief Maximal number of counters allocated between two commits
+ *        of sector counter store.
+ */
+#define BCMLIB_DEC_COUNTER_BATCH_SIZE (64)
+
+
+/**
+ * @brief Enumeration, that contains a set of possible
+ *        results of sector counter store operations
+ */
+typedef enum tag_dec_counter_store_result
+{
+    dec_counter_store_ok,         /**< Operation succeeded */
+    dec_counter_store_invalid,    /**< Region is too small or damaged, or sector is out of range */
+    dec_counter_store_batch_full, /**< Batch is full, it must be committed first */
+    dec_counter_store_overflow,   /**< Sector is too far ahead of others in its page, lagging ones must be rewritten */
+} dec_counter_store_result;
+
+
+/**
+ * @brief Sector counter of a sector.
+ */
+typedef struct tagDEC_SECTOR_COUNTER
+{
+    unsigned long long sector;  /**< Number of sector */
+    unsigned long long counter; /**< Sector counter */
+} DEC_SECTOR_COUNTER;
+
+
+/**
+ * @brief Routine, that makes a part of the region durable
+ *        (e.g. `msync` or `FlushViewOfFile` followed by `FlushFileBuffers`).
+ *
+ * @param user_context arbitrary user-defined context
+ * @param address address of the part
+ * @param size size of the part in bytes
+ */
+typedef void (*bcmlib_flush_routine)(void* user_context, const void* address, unsigned long long size);
+
+
+/**
+ * @brief Persistent store of sector counters over a region mapped by a caller.
+ *        Counters are kept in pages as 32-bit deltas from a per-page base, so
+ *        a sector takes about 4 bytes. Allocated counters are collected in a
+ *        batch and are written to pages by `dec_counter_store_commit` through
+ *        a journal, so pages are consistent after a crash at any moment.
+ */
+typedef struct tagDEC_COUNTER_STORE
+{
+    volatile long lock;                                      /**< Spinlock, that guards batch and pages */
+    volatile long commit_lock;                               /**< Spinlock, that serializes commits */
+    unsigned long long sectors;                              /**< Number of sectors */
+    void* region;                                            /**< Caller-mapped region */
+    bcmlib_flush_routine flush;                              /**< Flush routine (may be NULL) */
+    void* user_context;                                      /**< Arbitrary user-defined context, passed to `flush` */
+    unsigned long pending;                                   /**< Number of counters in batch */
+    unsigned long committing;                                /**< Number of counters being committed */
+    DEC_SECTOR_COUNTER batch[BCMLIB_DEC_COUNTER_BATCH_SIZE]; /**< Allocated, but not committed counters */
+} DEC_COUNTER_STORE;
+
+
+/**
+ * @brief DEC context: master key with caches of derived keys.
+ *        Master key, cipher and caches MUST outlive the context.
+ *        Partition and sector keys may share one cache.
+ */
+typedef struct tagDEC_CONTEXT
+{
+    const KEY* master_key;            /**< Master key (initialized for encryption) */
+    unsigned long long master_key_id; /**< Identifier of master key in caches */
+    const BLOCK_CIPHER* cipher;       /**< Cipher interface */
+    DEC_KEY_CACHE* partition_keys;    /**< Cache of partition keys (may be NULL) */
+    DEC_KEY_CACHE* sector_keys;       /**< Cache of sector keys (may be NULL) */
+    DEC_KEYSTREAM_CACHE* keystreams;  /**< Cache of prefetched keystreams (may be NULL) */
+    DEC_KEY_STORE* key_store;         /**< Persistent store of partition keys (may be NULL) */
+} DEC_CONTEXT;
+
+
+/**
+ * @brief Predicted write (or read), which keystream should be prefetched.
+ */
+typedef struct tagDEC_KEYSTREAM_REQUEST
+{
+    unsigned long long partition;         /**< Partition number */
+    unsigned long long partition_counter; /**< Partition counter */
+    unsigned long long sector;            /**< Number of sector in the partition */
+    unsigned long long sector_counter;    /**< Sector counter of the predicted write */
+} DEC_KEYSTREAM_REQUEST;
+
+
+/**
+ * @brief Context of `dec_keystream_prefetch_routine`.
+ */
+typedef struct tagDEC_PREFETCH_CONTEXT
+{
+    const DEC_CONTEXT* context;             /**< DEC context with attached keystream cache */
+    const DEC_KEYSTREAM_REQUEST* requests;  /**< Requests, one per task */
+} DEC_PREFETCH_CONTEXT;
+
+
 /**
  * @brief Encrypts a sector in DEC mode of operation.
  * 
@@ -84,6 +260,519 @@ void dec_decrypt_perform(unsigned long long partition, unsigned long long partit
                          unsigned char* out, const BLOCK_CIPHER* cipher);
 
 
+/**
+ * @brief Returns size of storage for a key cache of `entries` entries.
+ *        Number of entries is rounded down to a multiple of cache associativity.
+ *
+ * @param entries desired number of cached keys
+ *
+ * @return size of storage in bytes
+ */
+unsigned long dec_key_cache_storage_size(unsigned long entries);
+
+
+/**
+ * @brief Initializes a key cache.
+ *
+ * @param cache cache to initialize
+ * @param storage storage of `dec_key_cache_storage_size(entries)` bytes, aligned on 16 bytes
+ * @param entries desired number of cached keys
+ */
+void dec_key_cache_init(DEC_KEY_CACHE* cache, void* storage, unsigned long entries);
+
+
+/**
+ * @brief Removes all entries from a key cache and wipes cached keys.
+ *        Cache remains usable after the call.
+ *
+ * @param cache cache to clear
+ */
+void dec_key_cache_clear(DEC_KEY_CACHE* cache);
+
+
+/**
+ * @brief Returns number of keystreams of `blocks` blocks, that fit into a budget.
+ *
+ * @param budget size of storage in bytes
+ * @param blocks number of blocks in a sector
+ *
+ * @return number of keystreams
+ */
+unsigned long dec_keystream_cache_slots(unsigned long budget, unsigned long blocks);
+
+
+/**
+ * @brief Initializes a keystream cache.
+ *
+ * @param cache cache to initialize
+ * @param storage storage of `budget` bytes, aligned on 16 bytes
+ * @param budget size of storage in bytes
+ * @param blocks number of blocks in a sector (keystreams of other sizes are not cached)
+ */
+void dec_keystream_cache_init(DEC_KEYSTREAM_CACHE* cache, void* storage, unsigned long budget, unsigned long blocks);
+
+
+/**
+ * @brief Removes all prefetched keystreams from a cache and wipes them.
+ *
+ * @param cache cache to clear
+ */
+void dec_keystream_cache_clear(DEC_KEYSTREAM_CACHE* cache);
+
+
+/**
+ * @brief Precomputes keystream of a sector for a predicted write and puts it
+ *        into keystream cache of the context (the oldest keystream is evicted,
+ *        if the cache is full). Then `dec_encrypt_context` (or decryption)
+ *        with the same parameters is just a XOR with this keystream.
+ *
+ * @param request predicted write
+ * @param context DEC context with attached keystream cache
+ */
+void dec_keystream_prefetch(const DEC_KEYSTREAM_REQUEST* request, const DEC_CONTEXT* context);
+
+
+/**
+ * @brief Prefetches keystream for `task`-th request of `DEC_PREFETCH_CONTEXT`.
+ *        The routine matches `bcmlib_task_routine`, so caller runs it on
+ *        its own background worker or via an executor.
+ *
+ * @param context pointer to `DEC_PREFETCH_CONTEXT`
+ * @param task index of request
+ */
+void dec_keystream_prefetch_routine(void* context, unsigned long task);
+
+
+/**
+ * @brief Returns size of a region for derived-key store of `entries` partitions.
+ *
+ * @param entries maximal number of stored partition keys
+ *
+ * @return size of region in bytes
+ */
+unsigned long long dec_key_store_region_size(unsigned long long entries);
+
+
+/**
+ * @brief Opens derived-key store over a caller-mapped region. An empty
+ *        (zero-filled) region is formatted. Keys are loaded lazily by DEC
+ *        functions, when the store is attached to `context->key_store`.
+ *        Entries of outdated partition counters are replaced in place.
+ *
+ * @param region caller-mapped region
+ * @param size size of the region in bytes
+ * @param keys storage for `BCMLIB_DEC_KEY_STORE_KEYS` expanded keys
+ * @param context DEC context with master key of the store
+ * @param store store to open
+ *
+ * @return 'dec_key_store_ok' if store is opened and 'dec_key_store_invalid' -- otherwise
+ */
+dec_key_store_result dec_key_store_open(void* region, unsigned long long size, KEY* keys,
+                                        const DEC_CONTEXT* context, DEC_KEY_STORE* store);
+
+
+/**
+ * @brief Formats a region for derived-key store (all entries are dropped)
+ *        and opens it.
+ *
+ * @param region caller-mapped region
+ * @param size size of the region in bytes
+ * @param keys storage for `BCMLIB_DEC_KEY_STORE_KEYS` expanded keys
+ * @param context DEC context with master key of the store
+ * @param store store to open
+ *
+ * @return 'dec_key_store_ok' if store is opened and 'dec_key_store_invalid' -- otherwise
+ */
+dec_key_store_result dec_key_store_format(void* region, unsigned long long size, KEY* keys,
+                                          const DEC_CONTEXT* context, DEC_KEY_STORE* store);
+
+
+/**
+ * @brief Closes derived-key store: wipes keys, that protect it.
+ *        Region itself is not modified.
+ *
+ * @param store store to close
+ */
+void dec_key_store_close(DEC_KEY_STORE* store);
+
+
+/**
+ * @brief Returns size of a region for sector counter store of `sectors` sectors.
+ *
+ * @param sectors number of sectors
+ *
+ * @return size of region in bytes
+ */
+unsigned long long dec_counter_store_region_size(unsigned long long sectors);
+
+
+/**
+ * @brief Opens sector counter store over a caller-mapped region. An empty
+ *        (zero-filled) region is formatted for `sectors` sectors, otherwise
+ *        an interrupted commit is finished.
+ *
+ * @param region caller-mapped region
+ * @param size size of the region in bytes
+ * @param sectors number of sectors
+ * @param flush routine, that makes a part of the region durable (may be NULL)
+ * @param user_context arbitrary user-defined context, passed to `flush`
+ * @param store store to open
+ *
+ * @return 'dec_counter_store_ok' if store is opened and 'dec_counter_store_invalid' -- otherwise
+ */
+dec_counter_store_result dec_counter_store_open(void* region, unsigned long long size, unsigned long long sectors,
+                                                bcmlib_flush_routine flush, void* user_context,
+                                                DEC_COUNTER_STORE* store);
+
+
+/**
+ * @brief Formats a region for sector counter store (all counters are reset
+ *        to 0) and opens it.
+ *
+ * @param region caller-mapped region
+ * @param size size of the region in bytes
+ * @param sectors number of sectors
+ * @param flush routine, that makes a part of the region durable (may be NULL)
+ * @param user_context arbitrary user-defined context, passed to `flush`
+ * @param store store to open
+ *
+ * @return 'dec_counter_store_ok' if store is opened and 'dec_counter_store_invalid' -- otherwise
+ */
+dec_counter_store_result dec_counter_store_format(void* region, unsigned long long size, unsigned long long sectors,
+                                                  bcmlib_flush_routine flush, void* user_context,
+                                                  DEC_COUNTER_STORE* store);
+
+
+/**
+ * @brief Returns the latest counter of a sector (including not committed
+ *        ones). Sectors, that were never written, have counter 0.
+ *
+ * @param store sector counter store
+ * @param sector number of sector
+ * @param counter pointer to a variable, that receives the counter
+ *
+ * @return 'dec_counter_store_ok' or 'dec_counter_store_invalid' if sector is out of range
+ */
+dec_counter_store_result dec_counter_store_get(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                               unsigned long long* counter);
+
+
+/**
+ * @brief Atomically allocates the next counter of a sector for a write.
+ *        Counter is added to the batch, that MUST be committed before data
+ *        encrypted with the counter is written, so a counter is never reused
+ *        after a crash. If a crash happens after the commit, but before data
+ *        is written, sector holds data encrypted with the previous counter.
+ *
+ * @param store sector counter store
+ * @param sector number of sector
+ * @param counter pointer to a variable, that receives the counter
+ *
+ * @return 'dec_counter_store_ok' if counter is allocated, 'dec_counter_store_batch_full'
+ *         if batch must be committed first, 'dec_counter_store_overflow' if
+ *         counter does not fit in its page and 'dec_counter_store_invalid'
+ *         if sector is out of range
+ */
+dec_counter_store_result dec_counter_store_next(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                                unsigned long long* counter);
+
+
+/**
+ * @brief Records a known counter of a sector, e.g. when counters are imported
+ *        from another store. Counter is added to the batch like by
+ *        `dec_counter_store_next` and MUST be greater, than the latest one.
+ *
+ * @param store sector counter store
+ * @param sector number of sector
+ * @param counter counter to record
+ *
+ * @return 'dec_counter_store_ok' if counter is recorded, 'dec_counter_store_batch_full'
+ *         if batch must be committed first, 'dec_counter_store_overflow' if
+ *         counter does not fit in its page and 'dec_counter_store_invalid'
+ *         if sector is out of range or counter is not greater, than the latest one
+ */
+dec_counter_store_result dec_counter_store_set(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                               unsigned long long counter);
+
+
+/**
+ * @brief Writes allocated counters into the store: batch is written to
+ *        the journal, journal is flushed, then pages are updated and flushed.
+ *        Counters may be allocated by other threads meanwhile.
+ *
+ * @param store sector counter store
+ */
+void dec_counter_store_commit(DEC_COUNTER_STORE* store);
+
+
+/**
+ * @brief Initializes DEC context without caches. Caches are attached
+ *        by assigning corresponding fields of the context.
+ *
+ * @param master_key master key (initialized for encryption)
+ * @param master_key_id identifier of master key, that distinguishes
+ *                      keys derived from different master keys in caches
+ * @param context context to initialize
+ * @param cipher cipher interface to use
+ */
+void dec_context_init(const KEY* master_key, unsigned long long master_key_id,
+                      DEC_CONTEXT* context, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Encrypts a sector in DEC mode of operation using DEC context.
+ *        Sector and partition keys are taken from caches, if they are attached.
+ *        Partition key, that is not cached, is loaded from key store (if it is
+ *        attached), otherwise it is derived and saved into the store.
+ *        Sector key is cached per normalized sector counter, so repeated
+ *        writes to a hot sector usually skip key derivation at all.
+ *        If keystream of the sector is prefetched, it is just XOR-ed
+ *        with data (and wiped, so it is used once).
+ *        Result is the same as of `dec_encrypt`.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param sector number of sector in the partition to encrypt
+ * @param sector_counter sector counter
+ * @param in data of the sector
+ * @param blocks number of blocks in the sector
+ * @param context DEC context
+ * @param out ciphertext
+ */
+void dec_encrypt_context(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long sector, unsigned long long sector_counter,
+                         const unsigned char* in, unsigned long blocks, const DEC_CONTEXT* context,
+                         unsigned char* out);
+
+
+/**
+ * @brief Decrypts a sector in DEC mode of operation using DEC context.
+ *        Result is the same as of `dec_decrypt`.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param sector number of sector in the partition to decrypt
+ * @param sector_counter sector counter
+ * @param in encrypted data of the sector
+ * @param blocks number of blocks in the sector
+ * @param context DEC context
+ * @param out plaintext
+ */
+void dec_decrypt_context(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long sector, unsigned long long sector_counter,
+                         const unsigned char* in, unsigned long blocks, const DEC_CONTEXT* context,
+                         unsigned char* out);
+
+
+/**
+ * @brief Encrypts several consecutive sectors of a partition in DEC mode of operation.
+ *        Partition key is derived once for all sectors.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param first_sector number of the first sector to encrypt
+ * @param sectors number of sectors
+ * @param sector_counters array of `sectors` sector counters
+ * @param in data of sectors, one after another
+ * @param blocks number of blocks in each sector
+ * @param master_key key used to encrypt data
+ * @param out ciphertext
+ * @param cipher cipher interface to use
+ */
+void dec_encrypt_sectors(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long first_sector, unsigned long sectors,
+                         const unsigned long long* sector_counters, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* master_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual encryption of several sectors in DEC mode.
+ *        This function exists for testing purposes.
+ */
+void dec_encrypt_sectors_perform(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const KEY* master_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts several consecutive sectors of a partition in DEC mode of operation.
+ *        Partition key is derived once for all sectors.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param first_sector number of the first sector to decrypt
+ * @param sectors number of sectors
+ * @param sector_counters array of `sectors` sector counters
+ * @param in encrypted data of sectors, one after another
+ * @param blocks number of blocks in each sector
+ * @param master_key key used to decrypt data
+ * @param out plaintext
+ * @param cipher cipher interface to use
+ */
+void dec_decrypt_sectors(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long first_sector, unsigned long sectors,
+                         const unsigned long long* sector_counters, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* master_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual decryption of several sectors in DEC mode.
+ *        This function exists for testing purposes.
+ */
+void dec_decrypt_sectors_perform(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const KEY* master_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Encrypts several consecutive sectors of a partition using DEC context.
+ *        Keys are taken from caches, if they are attached. Partition key is
+ *        obtained at most once for all sectors.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param first_sector number of the first sector to encrypt
+ * @param sectors number of sectors
+ * @param sector_counters array of `sectors` sector counters
+ * @param in data of sectors, one after another
+ * @param blocks number of blocks in each sector
+ * @param context DEC context
+ * @param out ciphertext
+ */
+void dec_encrypt_sectors_context(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const DEC_CONTEXT* context, unsigned char* out);
+
+
+/**
+ * @brief Decrypts several consecutive sectors of a partition using DEC context.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param first_sector number of the first sector to decrypt
+ * @param sectors number of sectors
+ * @param sector_counters array of `sectors` sector counters
+ * @param in encrypted data of sectors, one after another
+ * @param blocks number of blocks in each sector
+ * @param context DEC context
+ * @param out plaintext
+ */
+void dec_decrypt_sectors_context(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const DEC_CONTEXT* context, unsigned char* out);
+
+
+/**
+ * @brief Obtains expanded sector key: from cache of the context, if possible,
+ *        or derives it. The key may be passed to `dec_*_blocks_perform`
+ *        for several accesses to the same sector.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param sector number of sector in the partition
+ * @param sector_counter sector counter
+ * @param sector_blocks number of blocks in the whole sector
+ * @param context DEC context
+ * @param out sector key (initialized for encryption)
+ */
+void dec_sector_key(unsigned long long partition, unsigned long long partition_counter,
+                    unsigned long long sector, unsigned long long sector_counter,
+                    unsigned long sector_blocks, const DEC_CONTEXT* context, KEY* out);
+
+
+/**
+ * @brief Encrypts a range of blocks of a sector in DEC mode of operation.
+ *
+ * Result is the same as the corresponding part of `dec_encrypt` output
+ * for the whole sector, but other blocks are not processed.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param sector number of sector in the partition to encrypt
+ * @param sector_counter sector counter
+ * @param sector_blocks number of blocks in the whole sector
+ * @param first_block index of the first block to encrypt in the sector
+ * @param in data of the blocks to encrypt
+ * @param blocks number of blocks to encrypt
+ * @param context DEC context
+ * @param out ciphertext
+ */
+void dec_encrypt_blocks_context(unsigned long long partition, unsigned long long partition_counter,
+                                unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const DEC_CONTEXT* context, unsigned char* out);
+
+
+/**
+ * @brief Decrypts a range of blocks of a sector in DEC mode of operation.
+ *
+ * @param partition partition number
+ * @param partition_counter partition counter
+ * @param sector number of sector in the partition to decrypt
+ * @param sector_counter sector counter
+ * @param sector_blocks number of blocks in the whole sector
+ * @param first_block index of the first block to decrypt in the sector
+ * @param in encrypted data of the blocks to decrypt
+ * @param blocks number of blocks to decrypt
+ * @param context DEC context
+ * @param out plaintext
+ */
+void dec_decrypt_blocks_context(unsigned long long partition, unsigned long long partition_counter,
+                                unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const DEC_CONTEXT* context, unsigned char* out);
+
+
+/**
+ * @brief Encrypts a range of blocks of a sector using a supplied sector key
+ *        (see `dec_sector_key`). No key is derived, so the cost is
+ *        proportional to the number of blocks only.
+ *
+ * @param sector number of sector in the partition to encrypt
+ * @param sector_counter sector counter
+ * @param sector_blocks number of blocks in the whole sector
+ * @param first_block index of the first block to encrypt in the sector
+ * @param in data of the blocks to encrypt
+ * @param blocks number of blocks to encrypt
+ * @param sector_key sector key
+ * @param out ciphertext
+ * @param cipher cipher interface to use
+ */
+void dec_encrypt_blocks_perform(unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const KEY* sector_key, unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts a range of blocks of a sector using a supplied sector key.
+ *
+ * @param sector number of sector in the partition to decrypt
+ * @param sector_counter sector counter
+ * @param sector_blocks number of blocks in the whole sector
+ * @param first_block index of the first block to decrypt in the sector
+ * @param in encrypted data of the blocks to decrypt
+ * @param blocks number of blocks to decrypt
+ * @param sector_key sector key
+ * @param out plaintext
+ * @param cipher cipher interface to use
+ */
+void dec_decrypt_blocks_perform(unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const KEY* sector_key, unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
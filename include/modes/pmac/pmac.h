@@ -0,0 +1,139 @@
+/**
+ * @file pmac.h
+ * @brief PMAC mode of operation header
+ */
+
+#ifndef BCMLIB_PMAC_INCLUDED
+#define BCMLIB_PMAC_INCLUDED
+
+#include "common/executor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+
+/**
+ * @brief Forward-declaration of block cipher interface (see bc-lib)
+ */
+typedef struct tagBLOCK_CIPHER BLOCK_CIPHER;
+
+
+/**
+ * @brief Forward-declaration of key structure (see bc-lib)
+ */
+typedef struct tagKEY KEY;
+
+
+/**
+ * @brief Possible values of `significant_bits` parameter.
+ */
+#define BCMLIB_PMAC_TAG_SIZE_64     (64)
+#define BCMLIB_PMAC_TAG_SIZE_128    (128)
+
+
+/**
+ * @brief Enumeration, that contains a set of possible
+ *        MAC verification results
+ */
+typedef enum tag_pmac_verify_result
+{
+    pmac_valid,   /**< Denotes successful PMAC tag verification */
+    pmac_invalid, /**< Denotes PMAC tag verification failure */
+} pmac_verify_result;
+
+
+/**
+ * @brief Computes PMAC using 128-bit block cipher.
+ *        Unlike CMAC, each block is masked by its own offset, that depends
+ *        on block's index only, so blocks are encrypted independently.
+ *        Tag is `significan_bits` bit long and is stored in most significant
+ *        bits of 128-bit output value.
+ *
+ * @param in set of several full 128-bit blocks to compute MAC for
+ * @param blocks number of blocks in data
+ * @param key MAC key
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_PMAC_TAG_SIZE_*` constants
+ * @param out pointer to a 128-bit value, that receives the value of MAC
+ * @param cipher cipher interface to use
+ */
+void pmac_digest(const unsigned char* in, unsigned long blocks,
+                 const unsigned char* key, unsigned long significant_bits,
+                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual PMAC digest calculation.
+ *        This function exists for testing purposes.
+ */
+void pmac_digest_perform(const unsigned char* in, unsigned long blocks,
+                         const KEY* key, unsigned long significant_bits,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Verifies MAC computed using 'pmac_digest'.
+ *
+ * @param in set of several full 128-bit blocks to verify MAC for
+ * @param blocks number of blocks in data
+ * @param key MAC key
+ * @param tag pointer to a 128-bit value, that contains the value of MAC
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_PMAC_TAG_SIZE_*` constants
+ * @param cipher cipher interface to use
+ *
+ * @return 'pmac_valid' if MAC is correct and 'pmac_invalid' -- otherwise
+ */
+pmac_verify_result pmac_verify(const unsigned char* in, unsigned long blocks,
+                               const unsigned char* key, const unsigned char* tag,
+                               unsigned long significant_bits, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual PMAC digest verification.
+ *        This function exists for testing purposes.
+ */
+pmac_verify_result pmac_verify_perform(const unsigned char* in, unsigned long blocks,
+                                       const KEY* key, const unsigned char* tag,
+                                       unsigned long significant_bits, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Computes PMAC of a large message using several threads.
+ *        Result is the same as of `pmac_digest`.
+ *
+ * Message is split into chunks of at least `min_chunk_blocks` blocks (but
+ * not more than `executor->concurrency` chunks), each chunk is processed
+ * by a separate executor's task, partial sums are combined afterwards.
+ * If message is too small to be split, it is processed in the calling thread.
+ *
+ * @param in set of several full 128-bit blocks to compute MAC for
+ * @param blocks number of blocks in data
+ * @param key MAC key
+ * @param significan_bits number of bits in MAC, other bits will be zeroed.
+ *                        Possible values: see `BCMLIB_PMAC_TAG_SIZE_*` constants
+ * @param out pointer to a 128-bit value, that receives the value of MAC
+ * @param min_chunk_blocks minimal number of blocks processed by a single task
+ * @param executor executor used to run tasks (may be NULL)
+ * @param cipher cipher interface to use
+ */
+void pmac_digest_parallel(const unsigned char* in, unsigned long blocks,
+                          const unsigned char* key, unsigned long significant_bits, unsigned char* out,
+                          unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual multithreaded PMAC digest calculation.
+ *        This function exists for testing purposes.
+ */
+void pmac_digest_parallel_perform(const unsigned char* in, unsigned long blocks,
+                                  const KEY* key, unsigned long significant_bits, unsigned char* out,
+                                  unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !BCMLIB_PMAC_INCLUDED
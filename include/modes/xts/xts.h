@@ -6,6 +6,8 @@
 #ifndef BCMLIB_XTS_INCLUDED
 #define BCMLIB_XTS_INCLUDED
 
+#include "common/executor.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif  // __cplusplus
@@ -73,6 +75,253 @@ void xts_decrypt_perform(unsigned long long sector, const unsigned char* in, uns
                          unsigned char* out, const BLOCK_CIPHER* cipher);
 
 
+/**
+ * @brief Encrypts several consecutive sectors in XTS mode of operation.
+ * 
+ * Result is the same as if `xts_encrypt` was called for each sector,
+ * but tweaks of all sectors are encrypted as a batch.
+ *
+ * @param first_sector number of the first sector to encrypt
+ * @param sectors number of sectors to encrypt
+ * @param in data of the sectors
+ * @param blocks number of blocks in each sector
+ * @param data_key key used to encrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out ciphertext
+ * @param cipher cipher interface to use
+ */
+void xts_encrypt_sectors(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual encryption of several sectors in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+void xts_encrypt_sectors_perform(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts several consecutive sectors in XTS mode of operation.
+ * 
+ * Result is the same as if `xts_decrypt` was called for each sector,
+ * but tweaks of all sectors are encrypted as a batch.
+ *
+ * @param first_sector number of the first sector to decrypt
+ * @param sectors number of sectors to decrypt
+ * @param in encrypted data of the sectors
+ * @param blocks number of blocks in each sector
+ * @param data_key key used to decrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out plaintext
+ * @param cipher cipher interface to use
+ */
+void xts_decrypt_sectors(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual decryption of several sectors in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+void xts_decrypt_sectors_perform(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Encrypts a range of blocks of a sector in XTS mode of operation.
+ * 
+ * Result is the same as the corresponding part of `xts_encrypt` output
+ * for the whole sector, but blocks before `first_block` are not processed.
+ *
+ * @param sector number of sector to encrypt
+ * @param first_block index of the first block to encrypt in the sector
+ * @param in data of the blocks to encrypt
+ * @param blocks number of blocks to encrypt
+ * @param data_key key used to encrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out ciphertext
+ * @param cipher cipher interface to use
+ */
+void xts_encrypt_blocks(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                        unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                        unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual encryption of a range of blocks in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+void xts_encrypt_blocks_perform(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                                unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts a range of blocks of a sector in XTS mode of operation.
+ * 
+ * Result is the same as the corresponding part of `xts_decrypt` output
+ * for the whole sector, but blocks before `first_block` are not processed.
+ *
+ * @param sector number of sector to decrypt
+ * @param first_block index of the first block to decrypt in the sector
+ * @param in encrypted data of the blocks to decrypt
+ * @param blocks number of blocks to decrypt
+ * @param data_key key used to decrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out plaintext
+ * @param cipher cipher interface to use
+ */
+void xts_decrypt_blocks(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                        unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                        unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual decryption of a range of blocks in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+void xts_decrypt_blocks_perform(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                                unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Encrypts a large data unit in XTS mode of operation using several threads.
+ * 
+ * Data unit is split into chunks of at least `min_chunk_blocks` blocks (but 
+ * not more than `executor->concurrency` chunks), each chunk is encrypted
+ * by a separate executor's task. If data unit is too small to be split,
+ * it is encrypted in the calling thread.
+ *
+ * @param sector number of sector (data unit) to encrypt
+ * @param in data of the sector
+ * @param blocks number of blocks in the sector
+ * @param data_key key used to encrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out ciphertext
+ * @param min_chunk_blocks minimal number of blocks processed by a single task
+ * @param executor executor used to run tasks (may be NULL)
+ * @param cipher cipher interface to use
+ */
+void xts_encrypt_parallel(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                          const unsigned char* data_key, const unsigned char* tweak_key, unsigned char* out,
+                          unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual multithreaded encryption in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+void xts_encrypt_parallel_perform(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                                  const KEY* data_key, const KEY* tweak_key, unsigned char* out,
+                                  unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts a large data unit in XTS mode of operation using several threads.
+ * 
+ * See `xts_encrypt_parallel` for details of splitting.
+ *
+ * @param sector number of sector (data unit) to decrypt
+ * @param in encrypted data of the sector
+ * @param blocks number of blocks in the sector
+ * @param data_key key used to decrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out plaintext
+ * @param min_chunk_blocks minimal number of blocks processed by a single task
+ * @param executor executor used to run tasks (may be NULL)
+ * @param cipher cipher interface to use
+ */
+void xts_decrypt_parallel(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                          const unsigned char* data_key, const unsigned char* tweak_key, unsigned char* out,
+                          unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual multithreaded decryption in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+void xts_decrypt_parallel_perform(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                                  const KEY* data_key, const KEY* tweak_key, unsigned char* out,
+                                  unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Enumeration, that contains a set of possible
+ *        results of arbitrary-length XTS processing
+ */
+typedef enum tag_xts_result
+{
+    xts_ok,             /**< Data unit is processed */
+    xts_invalid_length, /**< Data unit is shorter than a block, output is not written */
+} xts_result;
+
+
+/**
+ * @brief Encrypts a data unit of arbitrary length in XTS mode of operation.
+ * 
+ * If the last block is incomplete, ciphertext stealing (IEEE 1619) is used,
+ * so ciphertext has exactly the same length as plaintext. Data unit must
+ * contain at least one complete block, otherwise the call fails with
+ * `xts_invalid_length`. Encryption can be performed in place.
+ *
+ * @param sector number of sector to encrypt
+ * @param in data of the sector
+ * @param size size of the sector in bytes
+ * @param data_key key used to encrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out ciphertext (may be equal to `in`)
+ * @param cipher cipher interface to use
+ * @return `xts_ok` on success, `xts_invalid_length` if `size` is less than a block
+ */
+xts_result xts_encrypt_bytes(unsigned long long sector, const unsigned char* in, unsigned long size,
+                             const unsigned char* data_key, const unsigned char* tweak_key,
+                             unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual encryption with ciphertext stealing in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+xts_result xts_encrypt_bytes_perform(unsigned long long sector, const unsigned char* in, unsigned long size,
+                                     const KEY* data_key, const KEY* tweak_key,
+                                     unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Decrypts a data unit of arbitrary length in XTS mode of operation.
+ * 
+ * See `xts_encrypt_bytes` for details.
+ *
+ * @param sector number of sector to decrypt
+ * @param in encrypted data of the sector
+ * @param size size of the sector in bytes
+ * @param data_key key used to decrypt data
+ * @param tweak_key key used to derive a tweak
+ * @param out plaintext (may be equal to `in`)
+ * @param cipher cipher interface to use
+ * @return `xts_ok` on success, `xts_invalid_length` if `size` is less than a block
+ */
+xts_result xts_decrypt_bytes(unsigned long long sector, const unsigned char* in, unsigned long size,
+                             const unsigned char* data_key, const unsigned char* tweak_key,
+                             unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
+/**
+ * @brief Performs actual decryption with ciphertext stealing in XTS mode. 
+ *        This function exists for testing purposes. 
+ */
+xts_result xts_decrypt_bytes_perform(unsigned long long sector, const unsigned char* in, unsigned long size,
+                                     const KEY* data_key, const KEY* tweak_key,
+                                     unsigned char* out, const BLOCK_CIPHER* cipher);
+
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
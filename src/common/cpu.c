@@ -0,0 +1,157 @@
+/**
+ * @file cpu.c
+ * @brief Runtime detection of CPU features.
+ */
+
+#include "common/cpu.h"
+#include "common/utils.h"
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#elif defined(__GNUC__)
+#   include <cpuid.h>
+#endif
+
+
+#if !defined(_KERNEL_MODE)
+
+/**
+ * @brief Cached features set (`BCMLIB_CPU_*` flags with 
+ *        `BCMLIB_CPUP_DETECTED` bit set after detection).
+ */
+#define BCMLIB_CPUP_DETECTED (0x80000000)
+
+static volatile unsigned long cpup_features = 0;
+
+
+/**
+ * @brief Executes CPUID instruction.
+ */
+BCMLIB_FORCEINLINE void cpup_cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int*)registers, (int)leaf, (int)subleaf);
+#elif defined(__GNUC__)
+    if (!__get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]))
+    {
+        registers[0] = registers[1] = registers[2] = registers[3] = 0;
+    }
+#endif
+}
+
+
+/**
+ * @brief Reads XCR0 register (set of register states saved by OS).
+ */
+BCMLIB_FORCEINLINE unsigned long long cpup_xcr0(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#elif defined(__GNUC__)
+    unsigned int eax;
+    unsigned int edx;
+
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+
+/**
+ * @brief Performs actual detection of CPU features.
+ */
+BCMLIB_FORCEINLINE unsigned long cpup_detect(void)
+{
+    unsigned long features = 0;
+    unsigned long long xcr0;
+    unsigned int registers[4];
+
+    //
+    // Basic features:
+    //   ECX[1]  = PCLMULQDQ (XMM registers only, no OS support required)
+    //
+
+    cpup_cpuid(1, 0, registers);
+
+    if (registers[2] & (1u << 1))
+    {
+        features |= BCMLIB_CPU_PCLMULQDQ;
+    }
+
+    //
+    // Check that OS saves YMM registers (OSXSAVE + AVX, XCR0[2:1])
+    //
+
+    if ((registers[2] & (1u << 27)) == 0 || (registers[2] & (1u << 28)) == 0)
+    {
+        return features;
+    }
+
+    xcr0 = cpup_xcr0();
+
+    if ((xcr0 & 0x06) != 0x06)
+    {
+        return features;
+    }
+
+    //
+    // Structured extended features:
+    //   EBX[5]  = AVX2
+    //   EBX[16] = AVX512F
+    //   ECX[10] = VPCLMULQDQ
+    //
+
+    cpup_cpuid(7, 0, registers);
+
+    if ((registers[2] & (1u << 10)) == 0)
+    {
+        return features;
+    }
+
+    if (registers[1] & (1u << 5))
+    {
+        features |= BCMLIB_CPU_AVX2_VPCLMULQDQ;
+    }
+
+    //
+    // AVX-512 additionally requires opmask and ZMM states (XCR0[7:5])
+    //
+
+    if ((registers[1] & (1u << 16)) && (xcr0 & 0xE0) == 0xE0)
+    {
+        features |= BCMLIB_CPU_AVX512_VPCLMULQDQ;
+    }
+
+    return features;
+}
+
+
+#endif  // !_KERNEL_MODE
+
+
+unsigned long bcmlib_cpu_features(void)
+{
+#if defined(_KERNEL_MODE)
+    //
+    // Kernel code must save extended state explicitly before
+    // using YMM/ZMM registers, so wide paths are never used here
+    //
+
+    return 0;
+#else
+    unsigned long features = cpup_features;
+
+    //
+    // Detection is idempotent, so concurrent first calls
+    // just store the same value
+    //
+
+    if (!(features & BCMLIB_CPUP_DETECTED))
+    {
+        features      = cpup_detect() | BCMLIB_CPUP_DETECTED;
+        cpup_features = features;
+    }
+
+    return features & ~BCMLIB_CPUP_DETECTED;
+#endif  // _KERNEL_MODE
+}
@@ -5,9 +5,45 @@
 
 #include "common/utils.h"
 
+#include <immintrin.h>
+
 
 long long bcmlib_swap_endian_ll(long long value)
 {
     BCMLIB_SWAP_ENDIAN_INPLACE(value);
     return value;
 }
+
+
+void bcmlib_spinlock_acquire(volatile long* lock)
+{
+    //
+    // Test-and-test-and-set: spin on plain reads while
+    // lock is owned, so cache line is not bounced
+    //
+
+    while (BCMLIB_INTERLOCKED_EXCHANGE(lock, 1))
+    {
+        while (*lock)
+        {
+            _mm_pause();
+        }
+    }
+}
+
+
+void bcmlib_spinlock_release(volatile long* lock)
+{
+    BCMLIB_INTERLOCKED_RELEASE(lock, 0);
+}
+
+
+void bcmlib_secure_zero(void* data, unsigned long size)
+{
+    volatile unsigned char* internal_data = (volatile unsigned char*)data;
+
+    while (size--)
+    {
+        *internal_data++ = 0;
+    }
+}
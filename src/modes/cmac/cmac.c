@@ -11,6 +11,12 @@
 #include <smmintrin.h>
 
 
+/**
+ * @brief Number of messages, which CBC chains are advanced in lockstep.
+ */
+#define CMACP_PARALLEL_MESSAGES 8
+
+
 /**
  * @brief Internal CMAC subkey
  */
@@ -44,29 +50,30 @@ BCMLIB_FORCEINLINE __m128i cmacp_mask(unsigned long significant_bits)
 
 
 /**
- * @brief Performs left shift of argument by one bit
- * 
- * Well... Actually it does NOT perform a correct left shift by 1 bit,
- * but it seems, that all test vectors are created assuming this
- * implementation from RFC 4493 :(
+ * @brief Doubles a subkey: shifts it left by one bit treating it as
+ *        a big-endian 128-bit value and adds B128, if MSB was set.
  */
-BCMLIB_FORCEINLINE __m128i cmacp_left_shift(__m128i in)
+BCMLIB_FORCEINLINE __m128i cmacp_double(__m128i in)
 {
-    signed int idx;
-    unsigned char overflow = 0;
-    __m128i result         = _mm_setzero_si128();
+    //
+    // Reverse bytes to get a little-endian value, then shift it:
+    // bit 63 goes to the high half, bit 127 is reduced by adding
+    // B128 = 0x87 to the low half. Carries are swapped between
+    // halves and multiplied by (1, 0x87) to select what to add.
+    //
 
-    unsigned char* internal_result = (unsigned char*)&result;
-    unsigned char* internal_in     = (unsigned char*)&in;
+    const __m128i reverse    = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i polynomial = _mm_setr_epi32(0x87, 0x00, 0x01, 0x00);
 
-    for (idx = 15; idx >= 0; --idx)
-    {
-        internal_result[idx] = internal_in[idx] << 1;
-        internal_result[idx] |= overflow;
-        overflow = (internal_in[idx] & 0x80) ? 1 : 0;
-    }
+    __m128i carry;
+
+    in    = _mm_shuffle_epi8(in, reverse);
+    carry = _mm_shuffle_epi32(_mm_srli_epi64(in, 63), 0x4E);
+
+    in = _mm_slli_epi64(in, 1);
+    in = _mm_xor_si128(in, _mm_mul_epu32(carry, polynomial));
 
-    return result;
+    return _mm_shuffle_epi8(in, reverse);
 }
 
 
@@ -80,74 +87,158 @@ BCMLIB_FORCEINLINE void cmacp_subkeys_init(const KEY* key, CMACP_SUBKEY* subkey1
     // GOST 34.13-2015
     //
 
-    __m128i temporary;
-    __m128i internal_subkey1;
-    __m128i internal_subkey2;
     __m128i R;
 
     //
-    // B128 = 0b00...0010000111 = 0x87
+    // R = Encrypt(K, 0...0)
     //
 
-    __m128i B128 = _mm_setr_epi32(0x00, 0x00, 0x00, 0x87000000);
-    __m128i mask = _mm_setr_epi32(0x80, 0x00, 0x00, 0x00);
+    cipher->encrypt_block(_mm_setzero_si128(), key, &R);
 
     //
-    // R = Encrypt(K, 0...0)
+    // If MSB(R) = 0, then K1 = (R << 1)
+    // Else                K1 = (R << 1) + B128;
+    //
+    // If MSB1(K1) = 0, then K2 = (K1 << 1)
+    // Else                  K2 = (K1 << 1) + B128
+    //
+    // B128 = 0b00...0010000111 = 0x87
     //
 
-    temporary = _mm_setr_epi32(0x00, 0x00, 0x00, 0x00);
-    cipher->encrypt_block(temporary, key, &R);
+    subkey1->key = cmacp_double(R);
+    subkey2->key = cmacp_double(subkey1->key);
+}
+
+
+/**
+ * @brief Computes CMAC of full blocks with a given first subkey.
+ */
+BCMLIB_FORCEINLINE __m128i cmacp_digest(const __m128i* in, unsigned long blocks, const KEY* key,
+                                        __m128i subkey1, const BLOCK_CIPHER* cipher)
+{
+    unsigned long block;
+    __m128i temporary;
 
     //
-    // If MSB(R) = 0, then K1 = (R << 1)
-    // Else                K1 = (R << 1) + B128;
+    // Process first N - 1 blocks
     //
 
-    internal_subkey1 = cmacp_left_shift(R);
+    temporary = _mm_setzero_si128();
 
-    if (!_mm_test_all_zeros(R, mask))
+    for (block = 0; block < blocks - 1; ++block)
     {
-        internal_subkey1 = _mm_xor_si128(internal_subkey1, B128);
+        temporary = _mm_xor_si128(temporary, in[block]);
+        cipher->encrypt_block(temporary, key, &temporary);
     }
 
-    subkey1->key = internal_subkey1;
+    //
+    // Process the last block
+    // It is additionall XOR-ed with the first subkey
+    //
+
+    temporary = _mm_xor_si128(temporary, subkey1);
+    temporary = _mm_xor_si128(temporary, in[block]);
+    cipher->encrypt_block(temporary, key, &temporary);
+
+    return temporary;
+}
+
+
+/**
+ * @brief Computes CMAC of up to `CMACP_PARALLEL_MESSAGES` messages of
+ *        full blocks in lockstep. Message `m` is located at `in + m * blocks`.
+ */
+BCMLIB_FORCEINLINE void cmacp_digest_many(const __m128i* in, unsigned long messages, unsigned long blocks,
+                                          const KEY* key, __m128i subkey1, __m128i* tags,
+                                          const BLOCK_CIPHER* cipher)
+{
+    unsigned long block;
+    unsigned long message;
+    unsigned long idx;
+
+    for (message = 0; message < messages; ++message)
+    {
+        tags[message] = _mm_setzero_si128();
+    }
 
     //
-    // If MSB1(K1) = 0, then K2 = (K1 << 1)
-    // Else                  K2 = (K1 << 1) + B128
+    // Chains of different messages are independent, so cipher
+    // is able to process a block of each message at once
     //
 
-    internal_subkey2 = cmacp_left_shift(internal_subkey1);
+    for (block = 0; block < blocks - 1; ++block)
+    {
+        for (message = 0, idx = block; message < messages; ++message, idx += blocks)
+        {
+            tags[message] = _mm_xor_si128(tags[message], in[idx]);
+            cipher->encrypt_block(tags[message], key, &tags[message]);
+        }
+    }
 
-    if (!_mm_test_all_zeros(internal_subkey1, mask))
+    for (message = 0, idx = blocks - 1; message < messages; ++message, idx += blocks)
     {
-        internal_subkey2 = _mm_xor_si128(internal_subkey2, B128);
+        tags[message] = _mm_xor_si128(tags[message], subkey1);
+        tags[message] = _mm_xor_si128(tags[message], in[idx]);
+        cipher->encrypt_block(tags[message], key, &tags[message]);
     }
+}
+
+
+/**
+ * @brief Compares a computed tag with a given one in constant time.
+ * 
+ * @return 0 if tags are equal and 1 otherwise
+ */
+BCMLIB_FORCEINLINE unsigned int cmacp_tags_differ(__m128i new_tag, const unsigned char* tag)
+{
+    //
+    // Mask of differing bytes is 0 for equal tags and 0x0001...0xFFFF
+    // otherwise, so adding 0xFFFF sets bit 16 iff tags differ
+    //
 
-    subkey2->key = internal_subkey2;
+    unsigned int difference = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(new_tag, _mm_loadu_si128((const __m128i*)tag))) ^ 0xFFFF;
+
+    return (difference + 0xFFFF) >> 16;
 }
 
 
-void cmac_digest(const unsigned char* in, unsigned long blocks,
-                 const unsigned char* key, unsigned long significant_bits,
-                 unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Compares a computed tag with a given one.
+ */
+BCMLIB_FORCEINLINE cmac_verify_result cmacp_compare(__m128i new_tag, const unsigned char* tag)
 {
-    KEY internal_key;
-    cipher->initialize_encrypt_key(key, &internal_key);
+    //
+    // Tag cannot have length greater than 128 bits (Kuznyechik block length).
+    // Calculate difference between tags (it should have no bits set to 1)
+    //
 
-    cmac_digest_perform(in, blocks, &internal_key, significant_bits, out, cipher);
+    __m128i difference = _mm_xor_si128(new_tag, _mm_loadu_si128((const __m128i*)tag));
+
+    return _mm_test_all_zeros(difference, difference)
+             ? cmac_valid
+             : cmac_invalid;
 }
 
 
-void cmac_digest_perform(const unsigned char* in, unsigned long blocks,
-                         const KEY* key, unsigned long significant_bits,
-                         unsigned char* out, const BLOCK_CIPHER* cipher)
+void cmac_context_init(const KEY* key, CMAC_CONTEXT* context, const BLOCK_CIPHER* cipher)
 {
-    unsigned int block;
+    CMACP_SUBKEY subkey1;
+    CMACP_SUBKEY subkey2;
+
+    cmacp_subkeys_init(key, &subkey1, &subkey2, cipher);
 
+    context->key    = key;
+    context->cipher = cipher;
+
+    _mm_storeu_si128((__m128i*)context->subkey1, subkey1.key);
+    _mm_storeu_si128((__m128i*)context->subkey2, subkey2.key);
+}
+
+
+void cmac_digest_context(const unsigned char* in, unsigned long blocks, const CMAC_CONTEXT* context,
+                         unsigned long significant_bits, unsigned char* out)
+{
     __m128i temporary;
-    __m128i mac_mask;
 
     const __m128i* internal_in = (const __m128i*)in;
     __m128i* internal_out      = (__m128i*)out;
@@ -158,38 +249,52 @@ void cmac_digest_perform(const unsigned char* in, unsigned long blocks,
     // full disk encryption setting, so all blocks are complete.
     //
 
-    CMACP_SUBKEY subkey1;
-    CMACP_SUBKEY unused;
-
-    cmacp_subkeys_init(key, &subkey1, &unused, cipher);
+    temporary = cmacp_digest(internal_in, blocks, context->key,
+                             _mm_loadu_si128((const __m128i*)context->subkey1), context->cipher);
 
     //
-    // Process first N - 1 blocks
+    // Now we need to truncate MAC to half of the block
     //
 
-    temporary = _mm_setr_epi32(0x00, 0x00, 0x00, 0x00);
+    *internal_out = _mm_and_si128(temporary, cmacp_mask(significant_bits));
+}
 
-    for (block = 0; block < blocks - 1; ++block)
-    {
-        temporary = _mm_xor_si128(temporary, internal_in[block]);
-        cipher->encrypt_block(temporary, key, &temporary);
-    }
+
+cmac_verify_result cmac_verify_context(const unsigned char* in, unsigned long blocks, const CMAC_CONTEXT* context,
+                                       const unsigned char* tag, unsigned long significant_bits)
+{
+    __m128i new_tag;
 
     //
-    // Process the last block
-    // It is additionall XOR-ed with the first subkey
+    // CMAC verification is very straightforward: just calculate tag for the
+    // data and compare with
     //
 
-    temporary = _mm_xor_si128(temporary, subkey1.key);
-    temporary = _mm_xor_si128(temporary, internal_in[block]);
-    cipher->encrypt_block(temporary, key, &temporary);
+    cmac_digest_context(in, blocks, context, significant_bits, (unsigned char*)&new_tag);
 
-    //
-    // Now we need to truncate MAC to half of the block
-    //
+    return cmacp_compare(new_tag, tag);
+}
+
+
+void cmac_digest(const unsigned char* in, unsigned long blocks,
+                 const unsigned char* key, unsigned long significant_bits,
+                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
+
+    cmac_digest_perform(in, blocks, &internal_key, significant_bits, out, cipher);
+}
+
+
+void cmac_digest_perform(const unsigned char* in, unsigned long blocks,
+                         const KEY* key, unsigned long significant_bits,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    CMAC_CONTEXT context;
+    cmac_context_init(key, &context, cipher);
 
-    mac_mask      = cmacp_mask(significant_bits);
-    *internal_out = _mm_and_si128(temporary, mac_mask);
+    cmac_digest_context(in, blocks, &context, significant_bits, out);
 }
 
 
@@ -208,28 +313,209 @@ cmac_verify_result cmac_verify_perform(const unsigned char* in, unsigned long bl
                                        const KEY* key, const unsigned char* tag,
                                        unsigned long significant_bits, const BLOCK_CIPHER* cipher)
 {
+    CMAC_CONTEXT context;
+    cmac_context_init(key, &context, cipher);
+
+    return cmac_verify_context(in, blocks, &context, tag, significant_bits);
+}
+
+
+void cmac_digest_many(const unsigned char* in, unsigned long messages, unsigned long blocks,
+                      const CMAC_CONTEXT* context, unsigned long significant_bits, unsigned char* out)
+{
+    unsigned long batch;
+    unsigned long message;
+
+    __m128i tags[CMACP_PARALLEL_MESSAGES];
+
+    const __m128i* internal_in = (const __m128i*)in;
+    __m128i* internal_out      = (__m128i*)out;
+
+    const __m128i subkey1  = _mm_loadu_si128((const __m128i*)context->subkey1);
+    const __m128i mac_mask = cmacp_mask(significant_bits);
+
+    while (messages)
+    {
+        batch = (messages < CMACP_PARALLEL_MESSAGES) ? messages : CMACP_PARALLEL_MESSAGES;
+
+        cmacp_digest_many(internal_in, batch, blocks, context->key, subkey1, tags, context->cipher);
+
+        for (message = 0; message < batch; ++message)
+        {
+            _mm_storeu_si128(&internal_out[message], _mm_and_si128(tags[message], mac_mask));
+        }
+
+        internal_in += batch * blocks;
+        internal_out += batch;
+        messages -= batch;
+    }
+}
+
+
+cmac_verify_result cmac_verify_many(const unsigned char* in, unsigned long messages, unsigned long blocks,
+                                    const CMAC_CONTEXT* context, const unsigned char* tags,
+                                    unsigned long significant_bits, unsigned char* results)
+{
+    unsigned long batch;
+    unsigned long message;
+    unsigned long idx;
+    unsigned int differ;
+    unsigned int any_differ = 0;
+
+    __m128i new_tags[CMACP_PARALLEL_MESSAGES];
+
+    const __m128i* internal_in = (const __m128i*)in;
+
+    const __m128i subkey1  = _mm_loadu_si128((const __m128i*)context->subkey1);
+    const __m128i mac_mask = cmacp_mask(significant_bits);
+
+    for (idx = 0; idx < (messages + 7) / 8; ++idx)
+    {
+        results[idx] = 0;
+    }
+
     //
-    // Tag cannot have length greater than 128 bits (Kuznyechik block length)
+    // Each comparison is constant-time and all tags are always
+    // compared, so timing does not depend on which tags are wrong
     //
 
-    __m128i new_tag;
-    __m128i given_tag;
-    __m128i difference;
+    for (idx = 0; idx < messages; idx += batch)
+    {
+        batch = (messages - idx < CMACP_PARALLEL_MESSAGES) ? messages - idx : CMACP_PARALLEL_MESSAGES;
+
+        cmacp_digest_many(internal_in, batch, blocks, context->key, subkey1, new_tags, context->cipher);
+
+        for (message = 0; message < batch; ++message)
+        {
+            differ = cmacp_tags_differ(_mm_and_si128(new_tags[message], mac_mask), tags + (idx + message) * 16);
+
+            results[(idx + message) >> 3] |= (unsigned char)(differ << ((idx + message) & 7));
+            any_differ |= differ;
+        }
+
+        internal_in += batch * blocks;
+    }
+
+    return any_differ ? cmac_invalid : cmac_valid;
+}
+
+
+void cmac_init(const CMAC_CONTEXT* context, CMAC_STATE* state)
+{
+    state->context  = context;
+    state->buffered = 0;
+
+    _mm_storeu_si128((__m128i*)state->chain, _mm_setzero_si128());
+}
+
+
+void cmac_update(CMAC_STATE* state, const unsigned char* in, unsigned long size)
+{
+    unsigned long idx;
+    unsigned long fill;
+
+    __m128i chain;
+
+    const KEY* key             = state->context->key;
+    const BLOCK_CIPHER* cipher = state->context->cipher;
 
     //
-    // CMAC verification is very straightforward: just calculate tag for the
-    // data and compare with
+    // The last block is processed differently, so a block is kept
+    // in the buffer (even a full one) until more data arrives
     //
 
-    cmac_digest_perform(in, blocks, key, significant_bits, (unsigned char*)&new_tag, cipher);
-    given_tag = _mm_loadu_si128((const __m128i*)tag);
+    if (state->buffered < sizeof(state->buffer))
+    {
+        fill = sizeof(state->buffer) - state->buffered;
+        fill = (size < fill) ? size : fill;
+
+        for (idx = 0; idx < fill; ++idx)
+        {
+            state->buffer[state->buffered + idx] = in[idx];
+        }
+
+        state->buffered += fill;
+        in += fill;
+        size -= fill;
+    }
+
+    if (!size)
+    {
+        return;
+    }
 
     //
-    // Now calculate difference between tags (it should have no bits set to 1)
+    // Buffer is full and is not the last block, so process it and
+    // then go through input directly, leaving the last (possibly
+    // full) block for the buffer
     //
 
-    difference = _mm_xor_si128(new_tag, given_tag);
-    return _mm_test_all_zeros(difference, difference)
-             ? cmac_valid
-             : cmac_invalid;
+    chain = _mm_loadu_si128((const __m128i*)state->chain);
+
+    chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i*)state->buffer));
+    cipher->encrypt_block(chain, key, &chain);
+
+    while (size > sizeof(state->buffer))
+    {
+        chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i*)in));
+        cipher->encrypt_block(chain, key, &chain);
+
+        in += sizeof(state->buffer);
+        size -= sizeof(state->buffer);
+    }
+
+    _mm_storeu_si128((__m128i*)state->chain, chain);
+
+    for (idx = 0; idx < size; ++idx)
+    {
+        state->buffer[idx] = in[idx];
+    }
+
+    state->buffered = size;
+}
+
+
+void cmac_final(CMAC_STATE* state, unsigned long significant_bits, unsigned char* out)
+{
+    unsigned long idx;
+
+    __m128i chain;
+    __m128i subkey;
+
+    //
+    // Full last block is XOR-ed with K1. Incomplete one
+    // is padded with 10...0 and is XOR-ed with K2.
+    //
+
+    if (state->buffered == sizeof(state->buffer))
+    {
+        subkey = _mm_loadu_si128((const __m128i*)state->context->subkey1);
+    }
+    else
+    {
+        state->buffer[state->buffered] = 0x80;
+
+        for (idx = state->buffered + 1; idx < sizeof(state->buffer); ++idx)
+        {
+            state->buffer[idx] = 0x00;
+        }
+
+        subkey = _mm_loadu_si128((const __m128i*)state->context->subkey2);
+    }
+
+    chain = _mm_loadu_si128((const __m128i*)state->chain);
+    chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i*)state->buffer));
+    chain = _mm_xor_si128(chain, subkey);
+
+    state->context->cipher->encrypt_block(chain, state->context->key, &chain);
+
+    _mm_storeu_si128((__m128i*)out, _mm_and_si128(chain, cmacp_mask(significant_bits)));
+
+    //
+    // Do not leave intermediate values in the state
+    //
+
+    _mm_storeu_si128((__m128i*)state->chain, _mm_setzero_si128());
+    _mm_storeu_si128((__m128i*)state->buffer, _mm_setzero_si128());
+    state->buffered = 0;
 }
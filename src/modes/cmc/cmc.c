@@ -6,7 +6,6 @@
 #include "modes/cmc/cmc.h"
 #include "common/utils.h"
 #include "bclib.h"
-#include "galoislib.h"
 
 #include <immintrin.h>
 
@@ -15,86 +14,256 @@
 #define HI32(n) ((n) >> 32)
 
 
-void cmc_encrypt(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
-                 const unsigned char* data_key, const unsigned char* tweak_key,
-                 unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Number of sectors, which CBC chains are advanced in lockstep.
+ * 
+ * CBC chain of a single sector is strictly serial, but chains of
+ * different sectors are independent, so the cipher is able to process
+ * a block of each sector without waiting for each other.
+ */
+#define CMCP_PARALLEL_SECTORS 8
+
+
+/**
+ * @brief Number of independent blocks of a single sector processed at once.
+ */
+#define CMCP_PARALLEL_BLOCKS 8
+
+
+/**
+ * @brief Multiplies a value by 2 in GF(2^128) (shift-and-reduce).
+ * 
+ * Equivalent to `gf128_multiply(value, two)`, but without general
+ * multiplication.
+ */
+BCMLIB_FORCEINLINE __m128i cmcp_double(__m128i value)
 {
-    KEY internal_data_key;
-    KEY internal_tweak_key;
+    //
+    // Shift left by 1 bit: bit 63 goes to the high half, bit 127
+    // is reduced modulo x^128 + x^7 + x^2 + x + 1. Carries are
+    // swapped between halves and multiplied by (1, 0x87) to
+    // select what to add to each half.
+    //
 
-    cipher->initialize_encrypt_key(data_key, &internal_data_key);
-    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+    const __m128i polynomial = _mm_setr_epi32(0x87, 0x00, 0x01, 0x00);
 
-    cmc_encrypt_perform(tweak, in, blocks, &internal_data_key,
-                        &internal_tweak_key, out, cipher);
+    __m128i carry = _mm_shuffle_epi32(_mm_srli_epi64(value, 63), 0x4E);
+
+    value = _mm_slli_epi64(value, 1);
+    value = _mm_xor_si128(value, _mm_mul_epu32(carry, polynomial));
+
+    return value;
 }
 
 
-void cmc_encrypt_perform(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
-                         const KEY* data_key, const KEY* tweak_key,
-                         unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Encrypts tweaks of `sectors` consecutive sectors at once.
+ */
+BCMLIB_FORCEINLINE void cmcp_tweaks_init(unsigned long long first_tweak, unsigned long sectors, const KEY* tweak_key,
+                                         __m128i* encrypted_tweaks, const BLOCK_CIPHER* cipher)
 {
-    unsigned int block;
+    unsigned long sector;
+    unsigned long long tweak;
 
-    __m128i temporary1;
-    __m128i temporary2;
-    __m128i encrypted_tweak;
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        tweak = first_tweak + sector;
+        cipher->encrypt_block(_mm_setr_epi32(LO32(tweak), HI32(tweak), 0x00, 0x00), tweak_key, &encrypted_tweaks[sector]);
+    }
+}
 
-    const __m128i* internal_in = (const __m128i*)in;
-    __m128i* internal_out      = (__m128i*)out;
 
-    __m128i internal_tweak = _mm_setr_epi32(LO32(tweak), HI32(tweak), 0x00, 0x00);
-    __m128i two            = _mm_setr_epi32(0x02, 0x00, 0x00, 0x00);
+/**
+ * @brief Encrypts up to `CMCP_PARALLEL_SECTORS` sectors in lockstep.
+ */
+BCMLIB_FORCEINLINE void cmcp_encrypt_sectors(const __m128i* encrypted_tweaks, const __m128i* in, unsigned long long blocks,
+                                             unsigned long sectors, const KEY* data_key, __m128i* out,
+                                             const BLOCK_CIPHER* cipher)
+{
+    unsigned long long block;
+    unsigned long long idx;
+    unsigned long sector;
+
+    __m128i temporary;
+    __m128i chains[CMCP_PARALLEL_SECTORS];
+    __m128i masks[CMCP_PARALLEL_SECTORS];
 
     //
-    // Encrypt tweak
+    // First CBC-encryption pass
     //
 
-    cipher->encrypt_block(internal_tweak, tweak_key, &encrypted_tweak);
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        chains[sector] = encrypted_tweaks[sector];
+    }
+
+    for (block = 0; block < blocks; ++block)
+    {
+        for (sector = 0, idx = block; sector < sectors; ++sector, idx += blocks)
+        {
+            chains[sector] = _mm_xor_si128(chains[sector], in[idx]);
+            cipher->encrypt_block(chains[sector], data_key, &chains[sector]);
+
+            out[idx] = chains[sector];
+        }
+    }
 
     //
-    // First CBC-encryption pass
+    // Masks depend on the first and the last blocks only,
+    // so masking is applied on the fly in the second pass
     //
 
-    temporary1 = encrypted_tweak;
+    for (sector = 0, idx = 0; sector < sectors; ++sector, idx += blocks)
+    {
+        masks[sector]  = cmcp_double(_mm_xor_si128(out[idx], out[idx + blocks - 1]));
+        chains[sector] = _mm_setzero_si128();
+    }
+
+    //
+    // Second CBC-encryption pass
+    //
 
     for (block = 0; block < blocks; ++block)
     {
-        temporary1 = _mm_xor_si128(temporary1, internal_in[block]);
-        cipher->encrypt_block(temporary1, data_key, &temporary1);
+        for (sector = 0, idx = blocks - block - 1; sector < sectors; ++sector, idx += blocks)
+        {
+            temporary = _mm_xor_si128(out[idx], masks[sector]);
+
+            cipher->encrypt_block(temporary, data_key, &out[idx]);
 
-        internal_out[block] = temporary1;
+            out[idx]       = _mm_xor_si128(chains[sector], out[idx]);
+            chains[sector] = temporary;
+        }
     }
 
+    for (sector = 0, idx = blocks - 1; sector < sectors; ++sector, idx += blocks)
+    {
+        out[idx] = _mm_xor_si128(encrypted_tweaks[sector], out[idx]);
+    }
+}
+
+
+/**
+ * @brief CBC-decrypts masked data in place: out[i] = Dec(out[i] + mask) + out[i - 1] + mask,
+ *        out[-1] + mask = iv.
+ * 
+ * Unlike CBC encryption, the input of each block decryption is known in
+ * advance, so blocks are decrypted as independent batches and chaining
+ * is applied afterwards as a cheap XOR.
+ */
+BCMLIB_FORCEINLINE void cmcp_cbc_decrypt(__m128i iv, __m128i mask, unsigned long long blocks, const KEY* data_key,
+                                         __m128i* out, const BLOCK_CIPHER* cipher)
+{
+    unsigned long long window;
+    unsigned long long block;
+
+    __m128i previous;
+    __m128i current;
+    __m128i decrypted[CMCP_PARALLEL_BLOCKS];
+
     //
-    // Masking
+    // Go from the beginning of data, because the preceding pass
+    // finishes there, so these blocks are most likely still in
+    // cache. Previous block is overwritten in place, hence it is
+    // kept in a register.
     //
 
-    temporary1 = _mm_xor_si128(internal_out[0], internal_out[blocks - 1]);
-    temporary1 = gf128_multiply(temporary1, two);
+    previous = iv;
 
-    for (block = 0; block < blocks; ++block)
+    while (blocks)
     {
-        internal_out[block] = _mm_xor_si128(internal_out[block], temporary1);
+        window = (blocks < CMCP_PARALLEL_BLOCKS) ? blocks : CMCP_PARALLEL_BLOCKS;
+
+        for (block = 0; block < window; ++block)
+        {
+            cipher->decrypt_block(_mm_xor_si128(out[block], mask), data_key, &decrypted[block]);
+        }
+
+        for (block = 0; block < window; ++block)
+        {
+            current    = _mm_xor_si128(out[block], mask);
+            out[block] = _mm_xor_si128(decrypted[block], previous);
+            previous   = current;
+        }
+
+        out += window;
+        blocks -= window;
     }
+}
+
+
+/**
+ * @brief Decrypts up to `CMCP_PARALLEL_SECTORS` sectors in lockstep.
+ */
+BCMLIB_FORCEINLINE void cmcp_decrypt_sectors(const __m128i* encrypted_tweaks, const __m128i* in, unsigned long long blocks,
+                                             unsigned long sectors, const KEY* data_key, __m128i* out,
+                                             const BLOCK_CIPHER* cipher)
+{
+    unsigned long long block;
+    unsigned long long idx;
+    unsigned long sector;
+
+    __m128i mask;
+    __m128i chains[CMCP_PARALLEL_SECTORS];
 
     //
-    // Second CBC-encryption pass
+    // Invert the second encryption pass. It is a chain from the
+    // last block to the first one (each decryption input depends
+    // on the previous decryption output), hence sectors are
+    // processed in lockstep.
     //
 
-    temporary1 = _mm_setzero_si128();
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        chains[sector] = encrypted_tweaks[sector];
+    }
 
     for (block = 0; block < blocks; ++block)
     {
-        temporary2 = internal_out[blocks - block - 1];
+        for (sector = 0, idx = blocks - block - 1; sector < sectors; ++sector, idx += blocks)
+        {
+            chains[sector] = _mm_xor_si128(chains[sector], in[idx]);
+            cipher->decrypt_block(chains[sector], data_key, &chains[sector]);
+
+            out[idx] = chains[sector];
+        }
+    }
+
+    //
+    // Inverse of the first encryption pass, that is an ordinary
+    // CBC-decryption with independent blocks. Unmasking is
+    // applied on the fly.
+    //
 
-        cipher->encrypt_block(internal_out[blocks - block - 1], data_key, &internal_out[blocks - block - 1]);
+    for (sector = 0; sector < sectors; ++sector, out += blocks)
+    {
+        mask = cmcp_double(_mm_xor_si128(out[0], out[blocks - 1]));
 
-        internal_out[blocks - block - 1] = _mm_xor_si128(temporary1, internal_out[blocks - block - 1]);
-        temporary1                       = temporary2;
+        cmcp_cbc_decrypt(encrypted_tweaks[sector], mask, blocks, data_key, out, cipher);
     }
+}
+
+
+void cmc_encrypt(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
+                 const unsigned char* data_key, const unsigned char* tweak_key,
+                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
 
-    internal_out[blocks - 1] = _mm_xor_si128(encrypted_tweak, internal_out[blocks - 1]);
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    cmc_encrypt_perform(tweak, in, blocks, &internal_data_key,
+                        &internal_tweak_key, out, cipher);
+}
+
+
+void cmc_encrypt_perform(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
+                         const KEY* data_key, const KEY* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    cmc_encrypt_large_perform(tweak, in, blocks, data_key, tweak_key, out, cipher);
 }
 
 
@@ -117,65 +286,163 @@ void cmc_decrypt_perform(unsigned long long tweak, const unsigned char* in, unsi
                          const KEY* data_key, const KEY* tweak_key,
                          unsigned char* out, const BLOCK_CIPHER* cipher)
 {
-    unsigned int block;
+    cmc_decrypt_large_perform(tweak, in, blocks, data_key, tweak_key, out, cipher);
+}
 
-    __m128i temporary1;
-    __m128i temporary2;
-    __m128i encrypted_tweak;
 
-    const __m128i* internal_in = (const __m128i*)in;
-    __m128i* internal_out      = (__m128i*)out;
+void cmc_encrypt_large(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                       const unsigned char* data_key, const unsigned char* tweak_key,
+                       unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    cmc_encrypt_large_perform(tweak, in, blocks, &internal_data_key,
+                              &internal_tweak_key, out, cipher);
+}
+
 
-    __m128i internal_tweak = _mm_setr_epi32(LO32(tweak), HI32(tweak), 0x00, 0x00);
-    __m128i two            = _mm_setr_epi32(0x02, 0x00, 0x00, 0x00);
+void cmc_encrypt_large_perform(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                               const KEY* data_key, const KEY* tweak_key,
+                               unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i encrypted_tweak;
 
     //
     // Encrypt tweak
     //
 
-    cipher->encrypt_block(internal_tweak, tweak_key, &encrypted_tweak);
+    cmcp_tweaks_init(tweak, 1, tweak_key, &encrypted_tweak, cipher);
 
     //
-    // First CBC-decryption pass
+    // Single sector is just a lockstep of length 1. Passes
+    // go in opposite directions, so each one starts with
+    // blocks, that the previous one has just touched.
     //
 
-    temporary1 = encrypted_tweak;
+    cmcp_encrypt_sectors(&encrypted_tweak, (const __m128i*)in, blocks, 1,
+                         data_key, (__m128i*)out, cipher);
+}
 
-    for (block = 0; block < blocks; ++block)
-    {
-        temporary1 = _mm_xor_si128(temporary1, internal_in[blocks - block - 1]);
-        cipher->decrypt_block(temporary1, data_key, &temporary1);
 
-        internal_out[block] = temporary1;
-    }
+void cmc_decrypt_large(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                       const unsigned char* data_key, const unsigned char* tweak_key,
+                       unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    cmc_decrypt_large_perform(tweak, in, blocks, &internal_data_key,
+                              &internal_tweak_key, out, cipher);
+}
+
+
+void cmc_decrypt_large_perform(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                               const KEY* data_key, const KEY* tweak_key,
+                               unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i encrypted_tweak;
 
     //
-    // Masking
+    // Encrypt tweak
     //
 
-    temporary1 = _mm_xor_si128(internal_out[0], internal_out[blocks - 1]);
-    temporary1 = gf128_multiply(temporary1, two);
-
-    for (block = 0; block < blocks; ++block)
-    {
-        internal_out[block] = _mm_xor_si128(internal_out[block], temporary1);
-    }
+    cmcp_tweaks_init(tweak, 1, tweak_key, &encrypted_tweak, cipher);
 
     //
-    // Second CBC-decryption pass
+    // Single sector is just a lockstep of length 1. Passes
+    // go in opposite directions, so each one starts with
+    // blocks, that the previous one has just touched.
     //
 
-    temporary1 = _mm_setzero_si128();
+    cmcp_decrypt_sectors(&encrypted_tweak, (const __m128i*)in, blocks, 1,
+                         data_key, (__m128i*)out, cipher);
+}
+
 
-    for (block = 0; block < blocks; ++block)
+void cmc_encrypt_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    cmc_encrypt_sectors_perform(first_tweak, sectors, in, blocks, &internal_data_key,
+                                &internal_tweak_key, out, cipher);
+}
+
+
+void cmc_encrypt_sectors_perform(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    unsigned long batch;
+
+    __m128i encrypted_tweaks[CMCP_PARALLEL_SECTORS];
+
+    const __m128i* internal_in = (const __m128i*)in;
+    __m128i* internal_out      = (__m128i*)out;
+
+    while (sectors)
     {
-        temporary2 = internal_out[blocks - block - 1];
+        batch = (sectors < CMCP_PARALLEL_SECTORS) ? sectors : CMCP_PARALLEL_SECTORS;
 
-        cipher->decrypt_block(internal_out[blocks - block - 1], data_key, &internal_out[blocks - block - 1]);
+        cmcp_tweaks_init(first_tweak, batch, tweak_key, encrypted_tweaks, cipher);
+        cmcp_encrypt_sectors(encrypted_tweaks, internal_in, blocks, batch, data_key, internal_out, cipher);
 
-        internal_out[blocks - block - 1] = _mm_xor_si128(temporary1, internal_out[blocks - block - 1]);
-        temporary1                       = temporary2;
+        internal_in += batch * blocks;
+        internal_out += batch * blocks;
+        first_tweak += batch;
+        sectors -= batch;
     }
+}
 
-    internal_out[blocks - 1] = _mm_xor_si128(encrypted_tweak, internal_out[blocks - 1]);
+
+void cmc_decrypt_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    cmc_decrypt_sectors_perform(first_tweak, sectors, in, blocks, &internal_data_key,
+                                &internal_tweak_key, out, cipher);
+}
+
+
+void cmc_decrypt_sectors_perform(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    unsigned long batch;
+
+    __m128i encrypted_tweaks[CMCP_PARALLEL_SECTORS];
+
+    const __m128i* internal_in = (const __m128i*)in;
+    __m128i* internal_out      = (__m128i*)out;
+
+    while (sectors)
+    {
+        batch = (sectors < CMCP_PARALLEL_SECTORS) ? sectors : CMCP_PARALLEL_SECTORS;
+
+        cmcp_tweaks_init(first_tweak, batch, tweak_key, encrypted_tweaks, cipher);
+        cmcp_decrypt_sectors(encrypted_tweaks, internal_in, blocks, batch, data_key, internal_out, cipher);
+
+        internal_in += batch * blocks;
+        internal_out += batch * blocks;
+        first_tweak += batch;
+        sectors -= batch;
+    }
 }
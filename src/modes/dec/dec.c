@@ -7,11 +7,226 @@
 #include "modes/cmac/cmac.h"
 #include "common/utils.h"
 #include "bclib.h"
+#include "galoislib.h"
 #include "kdflib.h"
 
 #include <immintrin.h>
 
 
+/**
+ * @brief Number of entries in a set of key cache.
+ */
+#define DECP_KEY_CACHE_WAYS 4
+
+
+/**
+ * @brief Number of counter blocks encrypted as an independent batch.
+ */
+#define DECP_PARALLEL_BLOCKS 8
+
+
+/**
+ * @brief Number of words in identifier of a cached key.
+ */
+#define DECP_KEY_ID_WORDS 6
+
+
+/**
+ * @brief Kinds of cached keys. Kind is the first word of identifier,
+ *        so keys of different kinds never collide in a shared cache.
+ */
+#define DECP_KEY_KIND_PARTITION 1
+#define DECP_KEY_KIND_SECTOR    2
+#define DECP_KEY_KIND_KEYSTREAM 3
+
+
+/**
+ * @brief Entry of key cache.
+ */
+typedef struct tagDECP_KEY_CACHE_ENTRY
+{
+    KEY key; /**< Expanded key */
+
+    unsigned long long id[DECP_KEY_ID_WORDS]; /**< Identifier of the key */
+
+    unsigned long long stamp; /**< Time of the last access (0 if entry is empty) */
+} DECP_KEY_CACHE_ENTRY;
+
+
+/**
+ * @brief Signature and version of derived-key store format.
+ */
+#define DECP_KEY_STORE_MAGIC   0x31534b4345444d42ull
+#define DECP_KEY_STORE_VERSION 1
+
+
+/**
+ * @brief Indices of keys, that protect derived-key store.
+ */
+#define DECP_KEY_STORE_WRAP_KEY 0
+#define DECP_KEY_STORE_MAC_KEY  1
+
+
+/**
+ * @brief Header of derived-key store region.
+ */
+typedef struct tagDECP_KEY_STORE_HEADER
+{
+    unsigned long long magic; /**< `DECP_KEY_STORE_MAGIC` (0 for an empty region) */
+
+    unsigned long long version; /**< `DECP_KEY_STORE_VERSION` */
+
+    unsigned long long entries; /**< Number of entries following the header */
+
+    unsigned long long key_size; /**< Size of stored keys in bytes */
+
+    unsigned char check[16]; /**< MAC of the fields above, binds the store to master key */
+} DECP_KEY_STORE_HEADER;
+
+
+/**
+ * @brief Entry of derived-key store. Entry is valid only if its tag is
+ *        correct, so an entry torn by a crash is just derived again.
+ */
+typedef struct tagDECP_KEY_STORE_ENTRY
+{
+    unsigned long long partition_counter; /**< Partition counter of the key */
+
+    unsigned long long partition; /**< Partition number */
+
+    unsigned long long used; /**< Non-zero if entry belongs to a partition */
+
+    unsigned long long reserved; /**< Reserved, zero */
+
+    unsigned char wrapped_key[BCMLIB_DEC_KEY_STORE_MAX_KEY_SIZE]; /**< Wrapped partition key */
+
+    unsigned char tag[16]; /**< MAC of partition, its counter and key, IV of wrapping */
+} DECP_KEY_STORE_ENTRY;
+
+
+/**
+ * @brief Signature and version of sector counter store format.
+ */
+#define DECP_COUNTER_STORE_MAGIC   0x31534344454d4342ull
+#define DECP_COUNTER_STORE_VERSION 1
+
+
+/**
+ * @brief Number of sectors in a counter page (page takes 4 KiB).
+ */
+#define DECP_COUNTER_PAGE_SECTORS 1020
+
+
+/**
+ * @brief Deltas of a page are rebased, when any of them reaches this value.
+ */
+#define DECP_COUNTER_REBASE_DELTA 0x80000000ull
+
+
+/**
+ * @brief Maximal delta of a counter from its page base.
+ */
+#define DECP_COUNTER_MAX_DELTA 0xffffffffull
+
+
+/**
+ * @brief Seeds of checksums of journal and spare page.
+ */
+#define DECP_COUNTER_JOURNAL_SEED 0x6c616e72756f6a31ull
+#define DECP_COUNTER_SPARE_SEED   0x6567617065726173ull
+
+
+/**
+ * @brief Header of sector counter store region.
+ */
+typedef struct tagDECP_COUNTER_STORE_HEADER
+{
+    unsigned long long magic; /**< `DECP_COUNTER_STORE_MAGIC` (0 for an empty region) */
+
+    unsigned long long version; /**< `DECP_COUNTER_STORE_VERSION` */
+
+    unsigned long long sectors; /**< Number of sectors */
+
+    unsigned long long page_sectors; /**< `DECP_COUNTER_PAGE_SECTORS` */
+
+    unsigned long long batch_size; /**< `BCMLIB_DEC_COUNTER_BATCH_SIZE` */
+
+    unsigned long long reserved[3]; /**< Reserved, zero */
+} DECP_COUNTER_STORE_HEADER;
+
+
+/**
+ * @brief Journal of the last commit. Journal is valid only if its checksum
+ *        is correct, so a journal torn by a crash is ignored (pages are not
+ *        modified until it is written).
+ */
+typedef struct tagDECP_COUNTER_JOURNAL
+{
+    unsigned long long count; /**< Number of counters in journal */
+
+    unsigned long long checksum; /**< Checksum of count and counters */
+
+    unsigned long long reserved[2]; /**< Reserved, zero */
+
+    DEC_SECTOR_COUNTER counters[BCMLIB_DEC_COUNTER_BATCH_SIZE]; /**< Committed counters */
+} DECP_COUNTER_JOURNAL;
+
+
+/**
+ * @brief Page of sector counters. Counter of a sector is `base + delta`,
+ *        base is the smallest counter of the page.
+ */
+typedef struct tagDECP_COUNTER_PAGE
+{
+    unsigned long long base; /**< Base of the page */
+
+    unsigned long long reserved; /**< Reserved, zero */
+
+    unsigned int deltas[DECP_COUNTER_PAGE_SECTORS]; /**< Deltas of sector counters */
+} DECP_COUNTER_PAGE;
+
+
+/**
+ * @brief Copy of a page being rebased. Rebase changes all deltas of a page,
+ *        so a new image is written here first and is copied again after a crash.
+ */
+typedef struct tagDECP_COUNTER_SPARE
+{
+    unsigned long long page; /**< Index of the page */
+
+    unsigned long long checksum; /**< Checksum of page index and image */
+
+    unsigned long long reserved[2]; /**< Reserved, zero */
+
+    DECP_COUNTER_PAGE image; /**< New image of the page */
+} DECP_COUNTER_SPARE;
+
+
+/**
+ * @brief State of a keystream slot.
+ */
+typedef enum tagDECP_KEYSTREAM_STATE
+{
+    decp_keystream_free,  /**< Slot holds nothing */
+    decp_keystream_busy,  /**< Slot is owned by a thread, that fills or consumes it */
+    decp_keystream_ready  /**< Slot holds a keystream */
+} DECP_KEYSTREAM_STATE;
+
+
+/**
+ * @brief Header of a keystream slot. Keystreams themselves are
+ *        stored separately, so they remain aligned on 16 bytes.
+ */
+typedef struct tagDECP_KEYSTREAM_SLOT
+{
+    unsigned long long id[DECP_KEY_ID_WORDS]; /**< Identifier of the keystream */
+
+    unsigned long long stamp; /**< Time of insertion */
+
+    DECP_KEYSTREAM_STATE state; /**< State of the slot */
+} DECP_KEYSTREAM_SLOT;
+
+
 /**
  * @brief Internal context, that is used in KDF functions.
  */
@@ -22,6 +237,8 @@ typedef struct tagDECP_KDF_CONTEXT
     unsigned long tag_size; /**< CMAC tag size in bits */
 
     unsigned long format_blocks; /**< Number of blocks in `decp_kdf_format` output */
+
+    CMAC_CONTEXT cmac_context; /**< CMAC context of the last used key (NULL key if none) */
 } DECP_KDF_CONTEXT;
 
 
@@ -107,58 +324,215 @@ BCMLIB_FORCEINLINE void decp_kdf_format(const unsigned char* z, unsigned long lo
  */
 BCLIB_FORCEINLINE void decp_kdf_mac(const unsigned char* key, const unsigned char* in, void* user_context, unsigned char* out)
 {
-    const KEY* internal_key         = (const KEY*)key;
-    const DECP_KDF_CONTEXT* context = (const DECP_KDF_CONTEXT*)user_context;
+    const KEY* internal_key   = (const KEY*)key;
+    DECP_KDF_CONTEXT* context = (DECP_KDF_CONTEXT*)user_context;
+
+    //
+    // KDF calls MAC several times with the same key,
+    // so CMAC subkeys are derived once per key
+    //
 
-    cmac_digest_perform(in, context->format_blocks, internal_key, context->tag_size, out, context->cipher);
+    if (context->cmac_context.key != internal_key)
+    {
+        cmac_context_init(internal_key, &context->cmac_context, context->cipher);
+    }
+
+    cmac_digest_context(in, context->format_blocks, &context->cmac_context, context->tag_size, out);
 }
 
 
-void dec_encrypt(unsigned long long partition, unsigned long long partition_counter,
-                 unsigned long long sector, unsigned long long sector_counter,
-                 const unsigned char* in, unsigned long blocks, const unsigned char* master_key,
-                 unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Copies `size` bytes.
+ */
+BCMLIB_FORCEINLINE void decp_copy_bytes(unsigned char* to, const unsigned char* from, unsigned long size)
 {
-    KEY internal_master_key;
-    decp_initialize_key(master_key, &internal_master_key, cipher);
+    unsigned long idx;
 
-    dec_encrypt_perform(partition, partition_counter, sector, sector_counter,
-                        in, blocks, &internal_master_key, out, cipher);
+    for (idx = 0; idx < size; ++idx)
+    {
+        to[idx] = from[idx];
+    }
 }
 
 
-void dec_encrypt_perform(unsigned long long partition, unsigned long long partition_counter,
-                         unsigned long long sector, unsigned long long sector_counter,
-                         const unsigned char* in, unsigned long blocks, const KEY* master_key,
-                         unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Copies an expanded key.
+ */
+BCMLIB_FORCEINLINE void decp_copy_key(const KEY* from, KEY* to)
 {
-    unsigned long long internal_key_size = cipher->key_size << 3;
-    unsigned long long counter_base      = sector_counter * blocks;
-    unsigned long long normalized_sector_counter;
-    unsigned long block;
+    decp_copy_bytes((unsigned char*)to, (const unsigned char*)from, sizeof(KEY));
+}
 
-    KEY partition_key_buffer;
-    KEY partition_key;
 
-    KEY sector_key_buffer;
-    KEY sector_key;
+/**
+ * @brief Returns the first entry of a set, where a key with given identifier lives.
+ */
+BCMLIB_FORCEINLINE DECP_KEY_CACHE_ENTRY* decp_key_cache_set(const DEC_KEY_CACHE* cache, const unsigned long long* id)
+{
+    unsigned long long hash = 0;
+    unsigned long word;
 
-    __m128i counter;
-    __m128i kdf_iv;
-    __m128i kdf_p;
-    __m128i kdf_format_buffer[2];
+    //
+    // Identifiers are mostly sequential numbers,
+    // so they are mixed before choosing a set
+    //
 
-    const __m128i* internal_in = (const __m128i*)in;
-    __m128i* internal_out      = (__m128i*)out;
+    for (word = 0; word < DECP_KEY_ID_WORDS; ++word)
+    {
+        hash = (hash ^ id[word]) * 0x9e3779b97f4a7c15ull;
+        hash = hash ^ (hash >> 29);
+    }
+
+    return (DECP_KEY_CACHE_ENTRY*)cache->entries + (hash % cache->sets) * DECP_KEY_CACHE_WAYS;
+}
+
+
+/**
+ * @brief Checks if an entry holds a key with given identifier.
+ */
+BCMLIB_FORCEINLINE int decp_key_cache_match(const DECP_KEY_CACHE_ENTRY* entry, const unsigned long long* id)
+{
+    unsigned long word;
+
+    if (!entry->stamp)
+    {
+        return 0;
+    }
+
+    for (word = 0; word < DECP_KEY_ID_WORDS; ++word)
+    {
+        if (entry->id[word] != id[word])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief Looks up a key in cache. Key is copied, so the entry
+ *        may be evicted by another thread right after the call.
+ *
+ * @return non-zero if key is found
+ */
+BCMLIB_FORCEINLINE int decp_key_cache_lookup(DEC_KEY_CACHE* cache, const unsigned long long* id, KEY* out)
+{
+    DECP_KEY_CACHE_ENTRY* set;
+    unsigned long way;
+    int found = 0;
+
+    if (!cache || !cache->sets)
+    {
+        return 0;
+    }
+
+    set = decp_key_cache_set(cache, id);
+
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    for (way = 0; way < DECP_KEY_CACHE_WAYS; ++way)
+    {
+        if (decp_key_cache_match(&set[way], id))
+        {
+            decp_copy_key(&set[way].key, out);
+            set[way].stamp = ++cache->clock;
+            found          = 1;
+            break;
+        }
+    }
+
+    if (found)
+    {
+        ++cache->hits;
+    }
+    else
+    {
+        ++cache->misses;
+    }
+
+    bcmlib_spinlock_release(&cache->lock);
+
+    return found;
+}
+
+
+/**
+ * @brief Inserts a key into cache. The least recently used entry
+ *        of the set is evicted (and wiped), if the set is full.
+ */
+BCMLIB_FORCEINLINE void decp_key_cache_insert(DEC_KEY_CACHE* cache, const unsigned long long* id, const KEY* key)
+{
+    DECP_KEY_CACHE_ENTRY* set;
+    DECP_KEY_CACHE_ENTRY* victim;
+    unsigned long way;
+    unsigned long word;
+
+    if (!cache || !cache->sets)
+    {
+        return;
+    }
+
+    set = decp_key_cache_set(cache, id);
+
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    //
+    // Another thread may have derived the same key concurrently,
+    // in that case its entry is just refreshed
+    //
+
+    victim = &set[0];
+
+    for (way = 0; way < DECP_KEY_CACHE_WAYS; ++way)
+    {
+        if (decp_key_cache_match(&set[way], id))
+        {
+            victim = &set[way];
+            break;
+        }
+
+        if (set[way].stamp < victim->stamp)
+        {
+            victim = &set[way];
+        }
+    }
+
+    bcmlib_secure_zero(&victim->key, sizeof(victim->key));
+
+    for (word = 0; word < DECP_KEY_ID_WORDS; ++word)
+    {
+        victim->id[word] = id[word];
+    }
+
+    decp_copy_key(key, &victim->key);
+    victim->stamp = ++cache->clock;
+
+    bcmlib_spinlock_release(&cache->lock);
+}
+
+
+/**
+ * @brief Derives a key via K = kdf2(key, IV, P).
+ *        Key is already initialized, so `kdf2_perform` is used.
+ */
+BCMLIB_FORCEINLINE void decp_derive_raw_key(const KEY* key, __m128i kdf_iv, __m128i kdf_p, unsigned char* out,
+                                            const BLOCK_CIPHER* cipher)
+{
+    unsigned long long internal_key_size = cipher->key_size << 3;
+
+    __m128i kdf_format_buffer[2];
 
     DECP_KDF_CONTEXT kdf_user_context = {
         .cipher        = cipher,
         .tag_size      = BCMLIB_CMAC_TAG_SIZE_128,
-        .format_blocks = BCMLIB_COUNTOF(kdf_format_buffer)
+        .format_blocks = BCMLIB_COUNTOF(kdf_format_buffer),
+        .cmac_context  = { .key = NULL }
     };
 
     R1323665_1_022_2018_KDF2_CONTEXT kdf_context = {
-        .key_buffer     = (unsigned char*)master_key,
+        .key_buffer     = (unsigned char*)key,
         .format_buffer  = (unsigned char*)kdf_format_buffer,
         .mac_size       = kdf_user_context.tag_size >> 3,
         .user_context   = &kdf_user_context,
@@ -167,65 +541,1777 @@ void dec_encrypt_perform(unsigned long long partition, unsigned long long partit
         .mac            = decp_kdf_mac
     };
 
-    //
-    // Derive partition key via:
-    //   IV  = 0
-    //   P   = partition || partition_counter
-    //   K_p = kdf2(master_key, IV, P)
-    //
-    // Since master key is already initialized here,
-    // I can use faster `kdf2_perform` function.
-    //
-    // Note, that due to endianness, I need to pass
-    // halves of 128-bit values in reverse order
-    // in comparison to formula.
-    //
-
-    kdf_iv = _mm_setzero_si128();
-    kdf_p  = _mm_set_epi64x(bcmlib_swap_endian_ll(partition_counter),
-                            bcmlib_swap_endian_ll(partition));
-
     r1323665_1_022_2018_kdf2_perform((const unsigned char*)&kdf_iv, internal_key_size,
                                      (const unsigned char*)&kdf_p, NULL, NULL,
-                                     &kdf_context, partition_key_buffer.key);
-
-    //
-    // Derive sector key via:
-    //   IV  = partition || 0
-    //   P   = (sector_counter / v) || sector
-    //   K_s = kdf2(K_p, IV, P)
-    //
+                                     &kdf_context, out);
+}
 
-    normalized_sector_counter = decp_fraction_ceil(sector_counter,
-                                                   decp_calculate_v(blocks, cipher->block_size));
 
-    kdf_iv = _mm_set_epi64x(0, bcmlib_swap_endian_ll(partition));
-    kdf_p  = _mm_set_epi64x(bcmlib_swap_endian_ll(sector),
-                            bcmlib_swap_endian_ll(normalized_sector_counter));
+/**
+ * @brief Derives an expanded key via K = kdf2(key, IV, P).
+ */
+BCMLIB_FORCEINLINE void decp_derive_key(const KEY* key, __m128i kdf_iv, __m128i kdf_p, KEY* out,
+                                        const BLOCK_CIPHER* cipher)
+{
+    KEY key_buffer;
 
-    kdf_context.key_buffer = (unsigned char*)&partition_key;
+    decp_derive_raw_key(key, kdf_iv, kdf_p, key_buffer.key, cipher);
+    decp_initialize_key(key_buffer.key, out, cipher);
 
-    r1323665_1_022_2018_kdf2(partition_key_buffer.key, (const unsigned char*)&kdf_iv,
-                             internal_key_size, (const unsigned char*)&kdf_p, NULL, NULL,
-                             &kdf_context, sector_key_buffer.key);
+    bcmlib_secure_zero(&key_buffer, sizeof(key_buffer));
+}
 
-    //
-    // Let's perform encryption
-    // Gamma is generated via:
-    //   ctr(t)  = sector || (sector_counter * blocks + t)
-    //   gamma_t = Enc(K_s, ctr(t))
-    //
 
-    cipher->initialize_encrypt_key(sector_key_buffer.key, &sector_key);
+/**
+ * @brief Returns header of derived-key store region.
+ */
+BCMLIB_FORCEINLINE DECP_KEY_STORE_HEADER* decp_key_store_header(const DEC_KEY_STORE* store)
+{
+    return (DECP_KEY_STORE_HEADER*)store->region;
+}
+
+
+/**
+ * @brief Returns entry of derived-key store region.
+ */
+BCMLIB_FORCEINLINE DECP_KEY_STORE_ENTRY* decp_key_store_entry(const DEC_KEY_STORE* store, unsigned long long entry)
+{
+    return (DECP_KEY_STORE_ENTRY*)(decp_key_store_header(store) + 1) + entry;
+}
+
+
+/**
+ * @brief Computes MAC of `blocks` blocks with keys of the store.
+ *
+ * Tag is the polynomial hash of blocks and their number, encrypted with
+ * MAC key. Unlike CMAC, it takes a single block encryption, so loading
+ * a key from the store is cheaper, than its derivation.
+ */
+BCMLIB_FORCEINLINE __m128i decp_key_store_mac(const DEC_KEY_STORE* store, const __m128i* in, unsigned long blocks,
+                                              const BLOCK_CIPHER* cipher)
+{
+    const __m128i hash_key = _mm_loadu_si128((const __m128i*)store->hash_key);
+
+    __m128i hash = _mm_setzero_si128();
+    __m128i tag;
+
+    unsigned long block;
 
     for (block = 0; block < blocks; ++block)
     {
-        counter = _mm_set_epi64x(bcmlib_swap_endian_ll(counter_base + block),
-                                 bcmlib_swap_endian_ll(sector));
+        hash = gf128_multiply(_mm_xor_si128(hash, in[block]), hash_key);
+    }
+
+    hash = gf128_multiply(_mm_xor_si128(hash, _mm_set_epi64x(0, (long long)blocks)), hash_key);
+
+    cipher->encrypt_block(hash, &store->keys[DECP_KEY_STORE_MAC_KEY], &tag);
+
+    return tag;
+}
+
+
+/**
+ * @brief Checks, if a computed tag differs from a stored one.
+ */
+BCMLIB_FORCEINLINE int decp_tags_differ(__m128i tag, const unsigned char* stored)
+{
+    __m128i difference = _mm_xor_si128(tag, _mm_loadu_si128((const __m128i*)stored));
+
+    return !_mm_test_all_zeros(difference, difference);
+}
+
+
+/**
+ * @brief Computes MAC of store header. It does not depend on header
+ *        contents, so it may be written before magic.
+ */
+BCMLIB_FORCEINLINE __m128i decp_key_store_check(const DEC_KEY_STORE* store, const BLOCK_CIPHER* cipher)
+{
+    __m128i message[2];
+
+    message[0] = _mm_set_epi64x(DECP_KEY_STORE_VERSION, (long long)DECP_KEY_STORE_MAGIC);
+    message[1] = _mm_set_epi64x((long long)cipher->key_size, (long long)store->entries);
+
+    return decp_key_store_mac(store, message, BCMLIB_COUNTOF(message), cipher);
+}
+
+
+/**
+ * @brief Computes MAC of an entry (partition, its counter and partition key).
+ */
+BCMLIB_FORCEINLINE __m128i decp_key_store_entry_mac(const DEC_KEY_STORE* store, const DECP_KEY_STORE_ENTRY* entry,
+                                                    const unsigned char* key, const BLOCK_CIPHER* cipher)
+{
+    unsigned long block;
+
+    __m128i message[1 + BCMLIB_DEC_KEY_STORE_MAX_KEY_SIZE / 16];
+
+    message[0] = _mm_set_epi64x((long long)entry->partition, (long long)entry->partition_counter);
+
+    for (block = 0; block < cipher->key_size / 16; ++block)
+    {
+        message[1 + block] = _mm_loadu_si128((const __m128i*)key + block);
+    }
+
+    return decp_key_store_mac(store, message, 1 + block, cipher);
+}
+
+
+/**
+ * @brief Wraps or unwraps a key: XORs it with keystream, that starts at entry's tag.
+ */
+BCMLIB_FORCEINLINE void decp_key_store_wrap(const DEC_KEY_STORE* store, const DECP_KEY_STORE_ENTRY* entry,
+                                            const unsigned char* in, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    const __m128i tag = _mm_loadu_si128((const __m128i*)entry->tag);
+
+    unsigned long block;
+
+    __m128i keystream;
+
+    for (block = 0; block < cipher->key_size / 16; ++block)
+    {
+        cipher->encrypt_block(_mm_xor_si128(tag, _mm_set_epi64x(0, (long long)block)),
+                              &store->keys[DECP_KEY_STORE_WRAP_KEY], &keystream);
+
+        _mm_storeu_si128((__m128i*)out + block,
+                         _mm_xor_si128(keystream, _mm_loadu_si128((const __m128i*)in + block)));
+    }
+}
+
+
+/**
+ * @brief Finds an entry of a partition or a free entry, where it may be stored.
+ *
+ * @return index of entry or `store->entries` if the store is full
+ */
+BCMLIB_FORCEINLINE unsigned long long decp_key_store_find(const DEC_KEY_STORE* store, unsigned long long partition)
+{
+    unsigned long long start = (partition * 0x9e3779b97f4a7c15ull) % store->entries;
+    unsigned long long probe;
+    unsigned long long idx;
+
+    const DECP_KEY_STORE_ENTRY* entry;
+
+    for (probe = 0; probe < store->entries; ++probe)
+    {
+        idx   = (start + probe) % store->entries;
+        entry = decp_key_store_entry(store, idx);
+
+        if (!entry->used || entry->partition == partition)
+        {
+            return idx;
+        }
+    }
+
+    return store->entries;
+}
+
+
+/**
+ * @brief Loads partition key from the store.
+ *
+ * @return non-zero if key is found and is authentic
+ */
+BCMLIB_FORCEINLINE int decp_key_store_load(DEC_KEY_STORE* store, unsigned long long partition,
+                                           unsigned long long partition_counter, KEY* out,
+                                           const BLOCK_CIPHER* cipher)
+{
+    DECP_KEY_STORE_ENTRY entry;
+    unsigned long long idx;
+    int found = 0;
+
+    KEY key_buffer;
+
+    if (!store)
+    {
+        return 0;
+    }
+
+    //
+    // Entry is copied under the lock, then it is
+    // verified and unwrapped without the lock
+    //
+
+    bcmlib_spinlock_acquire(&store->lock);
+
+    idx = decp_key_store_find(store, partition);
+
+    if (idx < store->entries && decp_key_store_entry(store, idx)->used)
+    {
+        entry = *decp_key_store_entry(store, idx);
+        found = 1;
+    }
+
+    bcmlib_spinlock_release(&store->lock);
+
+    //
+    // Entry of an outdated counter is not used: a new key
+    // will be derived and saved instead of it
+    //
+
+    if (!found || entry.partition_counter != partition_counter)
+    {
+        return 0;
+    }
+
+    //
+    // Key is unwrapped first, then its tag is checked
+    //
+
+    decp_key_store_wrap(store, &entry, entry.wrapped_key, key_buffer.key, cipher);
+
+    if (decp_tags_differ(decp_key_store_entry_mac(store, &entry, key_buffer.key, cipher), entry.tag))
+    {
+        bcmlib_secure_zero(&key_buffer, sizeof(key_buffer));
+        return 0;
+    }
+
+    decp_initialize_key(key_buffer.key, out, cipher);
+
+    bcmlib_secure_zero(&key_buffer, sizeof(key_buffer));
+
+    return 1;
+}
+
+
+/**
+ * @brief Saves partition key (not expanded) into the store. Nothing
+ *        is saved, if the store is full.
+ */
+BCMLIB_FORCEINLINE void decp_key_store_save(DEC_KEY_STORE* store, unsigned long long partition,
+                                            unsigned long long partition_counter, const unsigned char* key,
+                                            const BLOCK_CIPHER* cipher)
+{
+    DECP_KEY_STORE_ENTRY entry = { 0 };
+    DECP_KEY_STORE_ENTRY* target;
+    unsigned long long idx;
+
+    if (!store)
+    {
+        return;
+    }
+
+    //
+    // Key is wrapped as in SIV: its MAC (with partition and its
+    // counter) is computed first and is used as IV of CTR mode,
+    // so unwrapping takes block encryptions only
+    //
+
+    entry.partition_counter = partition_counter;
+    entry.partition         = partition;
+    entry.used              = 1;
+
+    _mm_storeu_si128((__m128i*)entry.tag, decp_key_store_entry_mac(store, &entry, key, cipher));
+
+    decp_key_store_wrap(store, &entry, key, entry.wrapped_key, cipher);
+
+    bcmlib_spinlock_acquire(&store->lock);
+
+    idx = decp_key_store_find(store, partition);
+
+    if (idx < store->entries)
+    {
+        target  = decp_key_store_entry(store, idx);
+        *target = entry;
+    }
+
+    bcmlib_spinlock_release(&store->lock);
+}
+
+
+/**
+ * @brief Derives keys, that protect the store, from master key and expands them.
+ */
+BCMLIB_FORCEINLINE void decp_key_store_keys_init(const DEC_CONTEXT* context, KEY* keys, DEC_KEY_STORE* store)
+{
+    //
+    // Partition keys are derived from master key with zero IV,
+    // so a distinct IV separates these keys from partition ones:
+    //   IV     = 1...1
+    //   P      = 0 || label
+    //   K_wrap = kdf2(master_key, IV, 1)
+    //   K_mac  = kdf2(master_key, IV, 2)
+    //   H      = msb_128(kdf2(master_key, IV, 3))
+    //
+
+    const __m128i kdf_iv = _mm_set1_epi32(-1);
+
+    KEY key_buffer;
+
+    decp_derive_raw_key(context->master_key, kdf_iv, _mm_set_epi64x(bcmlib_swap_endian_ll(1), 0),
+                        key_buffer.key, context->cipher);
+
+    context->cipher->initialize_encrypt_key(key_buffer.key, &keys[DECP_KEY_STORE_WRAP_KEY]);
+
+    decp_derive_raw_key(context->master_key, kdf_iv, _mm_set_epi64x(bcmlib_swap_endian_ll(2), 0),
+                        key_buffer.key, context->cipher);
+
+    context->cipher->initialize_encrypt_key(key_buffer.key, &keys[DECP_KEY_STORE_MAC_KEY]);
+
+    decp_derive_raw_key(context->master_key, kdf_iv, _mm_set_epi64x(bcmlib_swap_endian_ll(3), 0),
+                        key_buffer.key, context->cipher);
+
+    decp_copy_bytes(store->hash_key, key_buffer.key, sizeof(store->hash_key));
+
+    bcmlib_secure_zero(&key_buffer, sizeof(key_buffer));
+
+    store->keys = keys;
+}
+
+
+/**
+ * @brief Checks, if the store may be used with the cipher.
+ */
+BCMLIB_FORCEINLINE int decp_key_store_supported(unsigned long long size, const BLOCK_CIPHER* cipher)
+{
+    return cipher->block_size == 16 &&
+           cipher->key_size % 16 == 0 &&
+           cipher->key_size <= BCMLIB_DEC_KEY_STORE_MAX_KEY_SIZE &&
+           size >= dec_key_store_region_size(1);
+}
+
+
+/**
+ * @brief Returns number of counter pages for `sectors` sectors.
+ */
+BCMLIB_FORCEINLINE unsigned long long decp_counter_pages(unsigned long long sectors)
+{
+    return (sectors + DECP_COUNTER_PAGE_SECTORS - 1) / DECP_COUNTER_PAGE_SECTORS;
+}
+
+
+/**
+ * @brief Returns header of sector counter store region.
+ */
+BCMLIB_FORCEINLINE DECP_COUNTER_STORE_HEADER* decp_counter_header(const DEC_COUNTER_STORE* store)
+{
+    return (DECP_COUNTER_STORE_HEADER*)store->region;
+}
+
+
+/**
+ * @brief Returns journal of sector counter store region.
+ */
+BCMLIB_FORCEINLINE DECP_COUNTER_JOURNAL* decp_counter_journal(const DEC_COUNTER_STORE* store)
+{
+    return (DECP_COUNTER_JOURNAL*)(decp_counter_header(store) + 1);
+}
+
+
+/**
+ * @brief Returns spare page of sector counter store region.
+ */
+BCMLIB_FORCEINLINE DECP_COUNTER_SPARE* decp_counter_spare(const DEC_COUNTER_STORE* store)
+{
+    return (DECP_COUNTER_SPARE*)(decp_counter_journal(store) + 1);
+}
+
+
+/**
+ * @brief Returns page of sector counter store region.
+ */
+BCMLIB_FORCEINLINE DECP_COUNTER_PAGE* decp_counter_page(const DEC_COUNTER_STORE* store, unsigned long long page)
+{
+    return (DECP_COUNTER_PAGE*)(decp_counter_spare(store) + 1) + page;
+}
+
+
+/**
+ * @brief Computes checksum of `count` 64-bit words (FNV-1a over words).
+ *        It only detects torn writes, region is not protected against tampering.
+ */
+BCMLIB_FORCEINLINE unsigned long long decp_checksum(const unsigned long long* words, unsigned long long count,
+                                                    unsigned long long seed)
+{
+    unsigned long long checksum = 0xcbf29ce484222325ull ^ seed;
+    unsigned long long idx;
+
+    for (idx = 0; idx < count; ++idx)
+    {
+        checksum = (checksum ^ words[idx]) * 0x100000001b3ull;
+    }
+
+    return checksum;
+}
+
+
+/**
+ * @brief Computes checksum of journal.
+ */
+BCMLIB_FORCEINLINE unsigned long long decp_counter_journal_checksum(const DECP_COUNTER_JOURNAL* journal)
+{
+    return decp_checksum(&journal->count, 1, DECP_COUNTER_JOURNAL_SEED) ^
+           decp_checksum((const unsigned long long*)journal->counters,
+                         journal->count * (sizeof(DEC_SECTOR_COUNTER) / sizeof(unsigned long long)),
+                         DECP_COUNTER_JOURNAL_SEED);
+}
+
+
+/**
+ * @brief Computes checksum of spare page.
+ */
+BCMLIB_FORCEINLINE unsigned long long decp_counter_spare_checksum(const DECP_COUNTER_SPARE* spare)
+{
+    return decp_checksum(&spare->page, 1, DECP_COUNTER_SPARE_SEED) ^
+           decp_checksum((const unsigned long long*)&spare->image,
+                         sizeof(spare->image) / sizeof(unsigned long long), DECP_COUNTER_SPARE_SEED);
+}
+
+
+/**
+ * @brief Makes a part of the region durable.
+ */
+BCMLIB_FORCEINLINE void decp_counter_flush(const DEC_COUNTER_STORE* store, const void* address,
+                                           unsigned long long size)
+{
+    if (store->flush)
+    {
+        store->flush(store->user_context, address, size);
+    }
+}
+
+
+/**
+ * @brief Returns page of a sector.
+ */
+BCMLIB_FORCEINLINE DECP_COUNTER_PAGE* decp_counter_sector_page(const DEC_COUNTER_STORE* store,
+                                                               unsigned long long sector)
+{
+    return decp_counter_page(store, sector / DECP_COUNTER_PAGE_SECTORS);
+}
+
+
+/**
+ * @brief Reads committed counter of a sector.
+ */
+BCMLIB_FORCEINLINE unsigned long long decp_counter_read(const DEC_COUNTER_STORE* store, unsigned long long sector)
+{
+    const DECP_COUNTER_PAGE* page = decp_counter_sector_page(store, sector);
+
+    return page->base + page->deltas[sector % DECP_COUNTER_PAGE_SECTORS];
+}
+
+
+/**
+ * @brief Finds the latest counter of a sector in batch.
+ *
+ * @return index of counter in batch or `store->pending` if there is no such counter
+ */
+BCMLIB_FORCEINLINE unsigned long decp_counter_find(const DEC_COUNTER_STORE* store, unsigned long long sector)
+{
+    unsigned long idx;
+
+    for (idx = store->pending; idx > 0; --idx)
+    {
+        if (store->batch[idx - 1].sector == sector)
+        {
+            return idx - 1;
+        }
+    }
+
+    return store->pending;
+}
+
 
-        cipher->encrypt_block(counter, &sector_key, &internal_out[block]);
-        internal_out[block] = _mm_xor_si128(internal_in[block], internal_out[block]);
+/**
+ * @brief Copies a page.
+ */
+BCMLIB_FORCEINLINE void decp_counter_copy_page(const DECP_COUNTER_PAGE* from, DECP_COUNTER_PAGE* to)
+{
+    decp_copy_bytes((unsigned char*)to, (const unsigned char*)from, sizeof(DECP_COUNTER_PAGE));
+}
+
+
+/**
+ * @brief Copies spare page (if it is valid) to its place. Page is copied under
+ *        the lock, because other threads read it while allocating counters.
+ */
+BCMLIB_FORCEINLINE void decp_counter_restore_spare(DEC_COUNTER_STORE* store)
+{
+    DECP_COUNTER_SPARE* spare = decp_counter_spare(store);
+    DECP_COUNTER_PAGE* page;
+
+    if (spare->page >= decp_counter_pages(store->sectors) ||
+        spare->checksum != decp_counter_spare_checksum(spare))
+    {
+        return;
     }
+
+    page = decp_counter_page(store, spare->page);
+
+    bcmlib_spinlock_acquire(&store->lock);
+    decp_counter_copy_page(&spare->image, page);
+    bcmlib_spinlock_release(&store->lock);
+
+    decp_counter_flush(store, page, sizeof(*page));
+
+    spare->checksum = 0;
+    decp_counter_flush(store, &spare->checksum, sizeof(spare->checksum));
+}
+
+
+/**
+ * @brief Moves base of a page to its smallest counter. Only commits
+ *        modify pages, so the page is read without the lock.
+ */
+BCMLIB_FORCEINLINE void decp_counter_rebase(DEC_COUNTER_STORE* store, const DECP_COUNTER_PAGE* page)
+{
+    DECP_COUNTER_SPARE* spare = decp_counter_spare(store);
+    unsigned long long index  = (unsigned long long)(page - decp_counter_page(store, 0));
+    unsigned int shift        = (unsigned int)DECP_COUNTER_MAX_DELTA;
+    unsigned long sectors     = DECP_COUNTER_PAGE_SECTORS;
+    unsigned long idx;
+
+    //
+    // The last page may be incomplete
+    //
+
+    if (store->sectors - index * DECP_COUNTER_PAGE_SECTORS < sectors)
+    {
+        sectors = (unsigned long)(store->sectors - index * DECP_COUNTER_PAGE_SECTORS);
+    }
+
+    for (idx = 0; idx < sectors; ++idx)
+    {
+        shift = page->deltas[idx] < shift ? page->deltas[idx] : shift;
+    }
+
+    if (!shift)
+    {
+        return;
+    }
+
+    //
+    // New image is written to spare page and is flushed, then
+    // the page is overwritten: a crash in the middle of it is
+    // fixed by copying the spare page again on open
+    //
+
+    decp_counter_copy_page(page, &spare->image);
+
+    spare->image.base += shift;
+
+    for (idx = 0; idx < sectors; ++idx)
+    {
+        spare->image.deltas[idx] -= shift;
+    }
+
+    spare->page     = index;
+    spare->checksum = decp_counter_spare_checksum(spare);
+
+    decp_counter_flush(store, spare, sizeof(*spare));
+
+    decp_counter_restore_spare(store);
+}
+
+
+/**
+ * @brief Writes counter of a sector into its page. Counters never decrease,
+ *        so the journal may be applied several times.
+ *
+ * @return non-zero if the page should be rebased
+ */
+BCMLIB_FORCEINLINE int decp_counter_write(const DEC_COUNTER_STORE* store, unsigned long long sector,
+                                          unsigned long long counter)
+{
+    DECP_COUNTER_PAGE* page = decp_counter_sector_page(store, sector);
+
+    if (counter > decp_counter_read(store, sector) && counter - page->base <= DECP_COUNTER_MAX_DELTA)
+    {
+        page->deltas[sector % DECP_COUNTER_PAGE_SECTORS] = (unsigned int)(counter - page->base);
+    }
+
+    //
+    // Counter may be already written by an interrupted commit,
+    // so the rebase is decided by the stored delta
+    //
+
+    return page->deltas[sector % DECP_COUNTER_PAGE_SECTORS] >= DECP_COUNTER_REBASE_DELTA;
+}
+
+
+/**
+ * @brief Writes counters of the journal into pages.
+ *
+ * @return number of pages, that should be rebased (they are stored into `rebase`)
+ */
+BCMLIB_FORCEINLINE unsigned long decp_counter_apply(const DEC_COUNTER_STORE* store, const DECP_COUNTER_JOURNAL* journal,
+                                                    const DECP_COUNTER_PAGE** rebase)
+{
+    const DECP_COUNTER_PAGE* page;
+    unsigned long long idx;
+    unsigned long pages = 0;
+    unsigned long known;
+
+    for (idx = 0; idx < journal->count; ++idx)
+    {
+        if (!decp_counter_write(store, journal->counters[idx].sector, journal->counters[idx].counter))
+        {
+            continue;
+        }
+
+        page = decp_counter_sector_page(store, journal->counters[idx].sector);
+
+        for (known = 0; known < pages && rebase[known] != page; ++known)
+        {
+        }
+
+        if (known == pages)
+        {
+            rebase[pages++] = page;
+        }
+    }
+
+    return pages;
+}
+
+
+/**
+ * @brief Flushes pages, that contain counters of the journal.
+ */
+BCMLIB_FORCEINLINE void decp_counter_flush_pages(const DEC_COUNTER_STORE* store, const DECP_COUNTER_JOURNAL* journal)
+{
+    const DECP_COUNTER_PAGE* flushed = NULL;
+    const DECP_COUNTER_PAGE* page;
+    unsigned long long idx;
+
+    for (idx = 0; idx < journal->count; ++idx)
+    {
+        page = decp_counter_sector_page(store, journal->counters[idx].sector);
+
+        if (page != flushed)
+        {
+            decp_counter_flush(store, page, sizeof(*page));
+            flushed = page;
+        }
+    }
+}
+
+
+/**
+ * @brief Rebases pages found by `decp_counter_apply`.
+ */
+BCMLIB_FORCEINLINE void decp_counter_rebase_pages(DEC_COUNTER_STORE* store, const DECP_COUNTER_PAGE** rebase,
+                                                  unsigned long pages)
+{
+    unsigned long idx;
+
+    for (idx = 0; idx < pages; ++idx)
+    {
+        decp_counter_rebase(store, rebase[idx]);
+    }
+}
+
+
+/**
+ * @brief Finishes a commit interrupted by a crash.
+ */
+BCMLIB_FORCEINLINE void decp_counter_recover(DEC_COUNTER_STORE* store)
+{
+    DECP_COUNTER_JOURNAL* journal = decp_counter_journal(store);
+    unsigned long long idx;
+    unsigned long pages;
+
+    const DECP_COUNTER_PAGE* rebase[BCMLIB_DEC_COUNTER_BATCH_SIZE];
+
+    decp_counter_restore_spare(store);
+
+    if (!journal->count ||
+        journal->count > BCMLIB_DEC_COUNTER_BATCH_SIZE ||
+        journal->checksum != decp_counter_journal_checksum(journal))
+    {
+        return;
+    }
+
+    for (idx = 0; idx < journal->count; ++idx)
+    {
+        if (journal->counters[idx].sector >= store->sectors)
+        {
+            return;
+        }
+    }
+
+    pages = decp_counter_apply(store, journal, rebase);
+
+    decp_counter_flush_pages(store, journal);
+    decp_counter_rebase_pages(store, rebase, pages);
+
+    journal->count = 0;
+    decp_counter_flush(store, &journal->count, sizeof(journal->count));
+}
+
+
+/**
+ * @brief Allocates the next counter of a sector or records a given one.
+ *
+ * @param counter counter to record or 0 to allocate the next one
+ */
+BCMLIB_FORCEINLINE dec_counter_store_result decp_counter_record(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                                                unsigned long long* counter)
+{
+    dec_counter_store_result result = dec_counter_store_ok;
+    unsigned long long latest;
+    unsigned long long next;
+    unsigned long idx;
+
+    if (sector >= store->sectors)
+    {
+        return dec_counter_store_invalid;
+    }
+
+    bcmlib_spinlock_acquire(&store->lock);
+
+    idx    = decp_counter_find(store, sector);
+    latest = idx < store->pending ? store->batch[idx].counter : decp_counter_read(store, sector);
+    next   = *counter ? *counter : latest + 1;
+
+    if (next <= latest)
+    {
+        result = *counter ? dec_counter_store_invalid : dec_counter_store_overflow;
+    }
+    else if (next - decp_counter_sector_page(store, sector)->base > DECP_COUNTER_MAX_DELTA)
+    {
+        result = dec_counter_store_overflow;
+    }
+    else if (idx < store->pending && idx >= store->committing)
+    {
+        store->batch[idx].counter = next;
+    }
+    else if (store->pending == BCMLIB_DEC_COUNTER_BATCH_SIZE)
+    {
+        result = dec_counter_store_batch_full;
+    }
+    else
+    {
+        //
+        // Counters being committed are not modified, so a new
+        // counter of such sector is appended to the batch
+        //
+
+        store->batch[store->pending].sector  = sector;
+        store->batch[store->pending].counter = next;
+        ++store->pending;
+    }
+
+    bcmlib_spinlock_release(&store->lock);
+
+    if (result == dec_counter_store_ok)
+    {
+        *counter = next;
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief Initializes store structure.
+ */
+BCMLIB_FORCEINLINE void decp_counter_store_init(void* region, unsigned long long sectors, bcmlib_flush_routine flush,
+                                                void* user_context, DEC_COUNTER_STORE* store)
+{
+    store->lock         = 0;
+    store->commit_lock  = 0;
+    store->sectors      = sectors;
+    store->region       = region;
+    store->flush        = flush;
+    store->user_context = user_context;
+    store->pending      = 0;
+    store->committing   = 0;
+}
+
+
+/**
+ * @brief Obtains partition key: from cache, if possible, or derives it.
+ */
+BCMLIB_FORCEINLINE void decp_partition_key(unsigned long long partition, unsigned long long partition_counter,
+                                           const DEC_CONTEXT* context, KEY* out)
+{
+    const unsigned long long id[DECP_KEY_ID_WORDS] = {
+        DECP_KEY_KIND_PARTITION, context->master_key_id, partition, partition_counter, 0, 0
+    };
+
+    KEY key_buffer;
+
+    if (decp_key_cache_lookup(context->partition_keys, id, out))
+    {
+        return;
+    }
+
+    if (decp_key_store_load(context->key_store, partition, partition_counter, out, context->cipher))
+    {
+        decp_key_cache_insert(context->partition_keys, id, out);
+        return;
+    }
+
+    //
+    // Derive partition key via:
+    //   IV  = 0
+    //   P   = partition || partition_counter
+    //   K_p = kdf2(master_key, IV, P)
+    //
+    // Note, that due to endianness, I need to pass
+    // halves of 128-bit values in reverse order
+    // in comparison to formula.
+    //
+
+    decp_derive_raw_key(context->master_key, _mm_setzero_si128(),
+                        _mm_set_epi64x(bcmlib_swap_endian_ll(partition_counter),
+                                       bcmlib_swap_endian_ll(partition)),
+                        key_buffer.key, context->cipher);
+
+    decp_initialize_key(key_buffer.key, out, context->cipher);
+    decp_key_store_save(context->key_store, partition, partition_counter, key_buffer.key, context->cipher);
+
+    bcmlib_secure_zero(&key_buffer, sizeof(key_buffer));
+
+    decp_key_cache_insert(context->partition_keys, id, out);
+}
+
+
+/**
+ * @brief Obtains sector key: from cache, if possible, or derives it.
+ *        Partition key is obtained on the first miss only and is
+ *        reused by subsequent calls (`partition_key_ready` tracks it).
+ */
+BCMLIB_FORCEINLINE void decp_sector_key(unsigned long long partition, unsigned long long partition_counter,
+                                        unsigned long long sector, unsigned long long sector_counter,
+                                        unsigned long blocks, const DEC_CONTEXT* context,
+                                        KEY* partition_key, int* partition_key_ready, KEY* out)
+{
+    //
+    // Sector key depends on normalized counter only, so consecutive
+    // writes to a sector, that share it, share the key as well
+    //
+
+    unsigned long long normalized_sector_counter = decp_fraction_ceil(sector_counter,
+                                                                      decp_calculate_v(blocks, context->cipher->block_size));
+
+    const unsigned long long id[DECP_KEY_ID_WORDS] = {
+        DECP_KEY_KIND_SECTOR, context->master_key_id, partition, partition_counter, sector, normalized_sector_counter
+    };
+
+    if (decp_key_cache_lookup(context->sector_keys, id, out))
+    {
+        return;
+    }
+
+    if (!*partition_key_ready)
+    {
+        decp_partition_key(partition, partition_counter, context, partition_key);
+        *partition_key_ready = 1;
+    }
+
+    //
+    // Derive sector key via:
+    //   IV  = partition || 0
+    //   P   = (sector_counter / v) || sector
+    //   K_s = kdf2(K_p, IV, P)
+    //
+
+    decp_derive_key(partition_key, _mm_set_epi64x(0, bcmlib_swap_endian_ll(partition)),
+                    _mm_set_epi64x(bcmlib_swap_endian_ll(sector),
+                                   bcmlib_swap_endian_ll(normalized_sector_counter)),
+                    out, context->cipher);
+
+    decp_key_cache_insert(context->sector_keys, id, out);
+}
+
+
+/**
+ * @brief Applies gamma to `blocks` blocks of the sector data starting from
+ *        counter value `first_counter`. If `in` is NULL, gamma itself is
+ *        stored into `out`.
+ */
+BCMLIB_FORCEINLINE void decp_gamma(unsigned long long sector, unsigned long long first_counter,
+                                   const unsigned char* in, unsigned long blocks, const KEY* sector_key,
+                                   unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    //
+    // Byte order of each 64-bit half is reversed by a single shuffle,
+    // counter in the high half is advanced by a single vector add
+    //
+
+    const __m128i swap_endian = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m128i increment   = _mm_set_epi64x(1, 0);
+
+    unsigned long block;
+    unsigned long window;
+    unsigned long idx;
+
+    __m128i counter;
+    __m128i gamma[DECP_PARALLEL_BLOCKS];
+
+    const __m128i* internal_in = (const __m128i*)in;
+    __m128i* internal_out      = (__m128i*)out;
+
+    //
+    // Gamma is generated via:
+    //   ctr(t)  = sector || (sector_counter * blocks + t)
+    //   gamma_t = Enc(K_s, ctr(t))
+    //
+
+    counter = _mm_set_epi64x((long long)first_counter, (long long)sector);
+
+    for (block = 0; block < blocks; block += window)
+    {
+        window = blocks - block;
+
+        if (window > DECP_PARALLEL_BLOCKS)
+        {
+            window = DECP_PARALLEL_BLOCKS;
+        }
+
+        //
+        // Counters do not depend on each other, so
+        // a whole window is encrypted as a batch
+        //
+
+        for (idx = 0; idx < window; ++idx)
+        {
+            gamma[idx] = _mm_shuffle_epi8(counter, swap_endian);
+            counter    = _mm_add_epi64(counter, increment);
+        }
+
+        for (idx = 0; idx < window; ++idx)
+        {
+            cipher->encrypt_block(gamma[idx], sector_key, &gamma[idx]);
+        }
+
+        for (idx = 0; idx < window; ++idx)
+        {
+            _mm_storeu_si128(internal_out + block + idx, internal_in
+                               ? _mm_xor_si128(_mm_loadu_si128(internal_in + block + idx), gamma[idx])
+                               : gamma[idx]);
+        }
+    }
+}
+
+
+/**
+ * @brief Returns keystream of a slot.
+ */
+BCMLIB_FORCEINLINE unsigned char* decp_keystream_data(const DEC_KEYSTREAM_CACHE* cache, unsigned long slot)
+{
+    return (unsigned char*)cache->storage + (unsigned long long)slot * cache->blocks * 16;
+}
+
+
+/**
+ * @brief Returns header of a slot. Headers follow all keystreams.
+ */
+BCMLIB_FORCEINLINE DECP_KEYSTREAM_SLOT* decp_keystream_slot(const DEC_KEYSTREAM_CACHE* cache, unsigned long slot)
+{
+    return (DECP_KEYSTREAM_SLOT*)decp_keystream_data(cache, cache->slots) + slot;
+}
+
+
+/**
+ * @brief Takes a prefetched keystream out of the cache. The slot becomes
+ *        busy, so it is neither evicted nor taken by another thread.
+ *
+ * @return index of the slot or `cache->slots` if keystream is not prefetched
+ */
+BCMLIB_FORCEINLINE unsigned long decp_keystream_take(DEC_KEYSTREAM_CACHE* cache, const unsigned long long* id,
+                                                     unsigned long blocks)
+{
+    DECP_KEYSTREAM_SLOT* header;
+    unsigned long slot;
+    unsigned long word;
+
+    if (!cache || !cache->slots || cache->blocks != blocks)
+    {
+        return cache ? cache->slots : 0;
+    }
+
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    for (slot = 0; slot < cache->slots; ++slot)
+    {
+        header = decp_keystream_slot(cache, slot);
+
+        if (header->state != decp_keystream_ready)
+        {
+            continue;
+        }
+
+        for (word = 0; word < DECP_KEY_ID_WORDS && header->id[word] == id[word]; ++word)
+        { }
+
+        if (word == DECP_KEY_ID_WORDS)
+        {
+            header->state = decp_keystream_busy;
+            break;
+        }
+    }
+
+    if (slot < cache->slots)
+    {
+        ++cache->hits;
+    }
+    else
+    {
+        ++cache->misses;
+    }
+
+    bcmlib_spinlock_release(&cache->lock);
+
+    return slot;
+}
+
+
+/**
+ * @brief Wipes a busy slot and returns it to the cache as a free one.
+ */
+BCMLIB_FORCEINLINE void decp_keystream_release(DEC_KEYSTREAM_CACHE* cache, unsigned long slot)
+{
+    bcmlib_secure_zero(decp_keystream_data(cache, slot), cache->blocks * 16);
+
+    bcmlib_spinlock_acquire(&cache->lock);
+    decp_keystream_slot(cache, slot)->state = decp_keystream_free;
+    bcmlib_spinlock_release(&cache->lock);
+}
+
+
+/**
+ * @brief Applies DEC to a single sector: keystream is taken from
+ *        keystream cache, if it is prefetched, or generated.
+ */
+BCMLIB_FORCEINLINE void decp_process_sector(unsigned long long partition, unsigned long long partition_counter,
+                                            unsigned long long sector, unsigned long long sector_counter,
+                                            const unsigned char* in, unsigned long blocks, const DEC_CONTEXT* context,
+                                            KEY* partition_key, int* partition_key_ready, unsigned char* out)
+{
+    const unsigned long long id[DECP_KEY_ID_WORDS] = {
+        DECP_KEY_KIND_KEYSTREAM, context->master_key_id, partition, partition_counter, sector, sector_counter
+    };
+
+    const __m128i* keystream;
+    unsigned long slot;
+    unsigned long block;
+
+    KEY sector_key;
+
+    slot = decp_keystream_take(context->keystreams, id, blocks);
+
+    if (context->keystreams && slot < context->keystreams->slots)
+    {
+        //
+        // Keystream is ready, so the only thing left is XOR.
+        // Keystream is never used twice, so it is wiped.
+        //
+
+        keystream = (const __m128i*)decp_keystream_data(context->keystreams, slot);
+
+        for (block = 0; block < blocks; ++block)
+        {
+            _mm_storeu_si128((__m128i*)out + block,
+                             _mm_xor_si128(_mm_loadu_si128((const __m128i*)in + block), keystream[block]));
+        }
+
+        decp_keystream_release(context->keystreams, slot);
+        return;
+    }
+
+    decp_sector_key(partition, partition_counter, sector, sector_counter, blocks,
+                    context, partition_key, partition_key_ready, &sector_key);
+
+    decp_gamma(sector, sector_counter * blocks, in, blocks, &sector_key, out, context->cipher);
+}
+
+
+unsigned long dec_key_cache_storage_size(unsigned long entries)
+{
+    return (entries / DECP_KEY_CACHE_WAYS) * DECP_KEY_CACHE_WAYS * sizeof(DECP_KEY_CACHE_ENTRY);
+}
+
+
+void dec_key_cache_init(DEC_KEY_CACHE* cache, void* storage, unsigned long entries)
+{
+    cache->lock    = 0;
+    cache->sets    = entries / DECP_KEY_CACHE_WAYS;
+    cache->clock   = 0;
+    cache->hits    = 0;
+    cache->misses  = 0;
+    cache->entries = storage;
+
+    bcmlib_secure_zero(storage, dec_key_cache_storage_size(entries));
+}
+
+
+void dec_key_cache_clear(DEC_KEY_CACHE* cache)
+{
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    bcmlib_secure_zero(cache->entries, cache->sets * DECP_KEY_CACHE_WAYS * sizeof(DECP_KEY_CACHE_ENTRY));
+    cache->clock = 0;
+
+    bcmlib_spinlock_release(&cache->lock);
+}
+
+
+unsigned long dec_keystream_cache_slots(unsigned long budget, unsigned long blocks)
+{
+    return budget / (blocks * 16 + sizeof(DECP_KEYSTREAM_SLOT));
+}
+
+
+void dec_keystream_cache_init(DEC_KEYSTREAM_CACHE* cache, void* storage, unsigned long budget, unsigned long blocks)
+{
+    cache->lock    = 0;
+    cache->slots   = dec_keystream_cache_slots(budget, blocks);
+    cache->blocks  = blocks;
+    cache->clock   = 0;
+    cache->hits    = 0;
+    cache->misses  = 0;
+    cache->storage = storage;
+
+    bcmlib_secure_zero(storage, budget);
+}
+
+
+void dec_keystream_cache_clear(DEC_KEYSTREAM_CACHE* cache)
+{
+    unsigned long slot;
+
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    //
+    // Busy slots are owned by other threads,
+    // they wipe these slots by themselves
+    //
+
+    for (slot = 0; slot < cache->slots; ++slot)
+    {
+        if (decp_keystream_slot(cache, slot)->state == decp_keystream_ready)
+        {
+            bcmlib_secure_zero(decp_keystream_data(cache, slot), cache->blocks * 16);
+            decp_keystream_slot(cache, slot)->state = decp_keystream_free;
+        }
+    }
+
+    bcmlib_spinlock_release(&cache->lock);
+}
+
+
+void dec_keystream_prefetch(const DEC_KEYSTREAM_REQUEST* request, const DEC_CONTEXT* context)
+{
+    DEC_KEYSTREAM_CACHE* cache = context->keystreams;
+    DECP_KEYSTREAM_SLOT* header;
+    DECP_KEYSTREAM_SLOT* victim = NULL;
+    unsigned long victim_slot   = 0;
+    unsigned long slot;
+    unsigned long word;
+
+    KEY partition_key;
+    KEY sector_key;
+
+    int partition_key_ready = 0;
+
+    const unsigned long long id[DECP_KEY_ID_WORDS] = {
+        DECP_KEY_KIND_KEYSTREAM, context->master_key_id, request->partition, request->partition_counter,
+        request->sector, request->sector_counter
+    };
+
+    if (!cache || !cache->slots)
+    {
+        return;
+    }
+
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    //
+    // Claim a free slot or evict the oldest keystream. Nothing
+    // is done, if keystream is already there or all slots are busy.
+    //
+
+    for (slot = 0; slot < cache->slots; ++slot)
+    {
+        header = decp_keystream_slot(cache, slot);
+
+        if (header->state == decp_keystream_busy)
+        {
+            continue;
+        }
+
+        if (header->state == decp_keystream_ready)
+        {
+            for (word = 0; word < DECP_KEY_ID_WORDS && header->id[word] == id[word]; ++word)
+            { }
+
+            if (word == DECP_KEY_ID_WORDS)
+            {
+                victim = NULL;
+                break;
+            }
+        }
+
+        if (!victim || (victim->state == decp_keystream_ready &&
+                        (header->state == decp_keystream_free || header->stamp < victim->stamp)))
+        {
+            victim      = header;
+            victim_slot = slot;
+        }
+    }
+
+    if (victim)
+    {
+        victim->state = decp_keystream_busy;
+    }
+
+    bcmlib_spinlock_release(&cache->lock);
+
+    if (!victim)
+    {
+        return;
+    }
+
+    //
+    // Keystream is generated out of the lock. Evicted
+    // keystream is overwritten by the new one.
+    //
+
+    decp_sector_key(request->partition, request->partition_counter, request->sector, request->sector_counter,
+                    cache->blocks, context, &partition_key, &partition_key_ready, &sector_key);
+
+    decp_gamma(request->sector, request->sector_counter * cache->blocks, NULL, cache->blocks, &sector_key,
+               decp_keystream_data(cache, victim_slot), context->cipher);
+
+    bcmlib_spinlock_acquire(&cache->lock);
+
+    for (word = 0; word < DECP_KEY_ID_WORDS; ++word)
+    {
+        victim->id[word] = id[word];
+    }
+
+    victim->stamp = ++cache->clock;
+    victim->state = decp_keystream_ready;
+
+    bcmlib_spinlock_release(&cache->lock);
+}
+
+
+void dec_keystream_prefetch_routine(void* context, unsigned long task)
+{
+    const DEC_PREFETCH_CONTEXT* internal_context = (const DEC_PREFETCH_CONTEXT*)context;
+
+    dec_keystream_prefetch(&internal_context->requests[task], internal_context->context);
+}
+
+
+unsigned long long dec_key_store_region_size(unsigned long long entries)
+{
+    return sizeof(DECP_KEY_STORE_HEADER) + entries * sizeof(DECP_KEY_STORE_ENTRY);
+}
+
+
+dec_key_store_result dec_key_store_open(void* region, unsigned long long size, KEY* keys,
+                                        const DEC_CONTEXT* context, DEC_KEY_STORE* store)
+{
+    const DECP_KEY_STORE_HEADER* header = (const DECP_KEY_STORE_HEADER*)region;
+
+    if (!decp_key_store_supported(size, context->cipher))
+    {
+        return dec_key_store_invalid;
+    }
+
+    if (!header->magic)
+    {
+        return dec_key_store_format(region, size, keys, context, store);
+    }
+
+    if (header->magic != DECP_KEY_STORE_MAGIC ||
+        header->version != DECP_KEY_STORE_VERSION ||
+        header->key_size != context->cipher->key_size ||
+        !header->entries ||
+        dec_key_store_region_size(header->entries) > size)
+    {
+        return dec_key_store_invalid;
+    }
+
+    store->lock    = 0;
+    store->entries = header->entries;
+    store->region  = region;
+
+    decp_key_store_keys_init(context, keys, store);
+
+    //
+    // Check value differs, if the store belongs to another master key
+    //
+
+    if (decp_tags_differ(decp_key_store_check(store, context->cipher), header->check))
+    {
+        dec_key_store_close(store);
+        return dec_key_store_invalid;
+    }
+
+    return dec_key_store_ok;
+}
+
+
+dec_key_store_result dec_key_store_format(void* region, unsigned long long size, KEY* keys,
+                                          const DEC_CONTEXT* context, DEC_KEY_STORE* store)
+{
+    DECP_KEY_STORE_HEADER* header = (DECP_KEY_STORE_HEADER*)region;
+
+    if (!decp_key_store_supported(size, context->cipher))
+    {
+        return dec_key_store_invalid;
+    }
+
+    store->lock    = 0;
+    store->entries = (size - sizeof(DECP_KEY_STORE_HEADER)) / sizeof(DECP_KEY_STORE_ENTRY);
+    store->region  = region;
+
+    decp_key_store_keys_init(context, keys, store);
+
+    //
+    // Magic is written last, so a region torn
+    // by a crash is formatted again on open
+    //
+
+    bcmlib_secure_zero(region, (unsigned long)dec_key_store_region_size(store->entries));
+
+    header->version  = DECP_KEY_STORE_VERSION;
+    header->entries  = store->entries;
+    header->key_size = context->cipher->key_size;
+
+    _mm_storeu_si128((__m128i*)header->check, decp_key_store_check(store, context->cipher));
+
+    header->magic = DECP_KEY_STORE_MAGIC;
+
+    return dec_key_store_ok;
+}
+
+
+void dec_key_store_close(DEC_KEY_STORE* store)
+{
+    if (store->keys)
+    {
+        bcmlib_secure_zero(store->keys, BCMLIB_DEC_KEY_STORE_KEYS * sizeof(KEY));
+    }
+
+    bcmlib_secure_zero(store->hash_key, sizeof(store->hash_key));
+
+    store->keys    = NULL;
+    store->region  = NULL;
+    store->entries = 0;
+}
+
+
+unsigned long long dec_counter_store_region_size(unsigned long long sectors)
+{
+    return sizeof(DECP_COUNTER_STORE_HEADER) + sizeof(DECP_COUNTER_JOURNAL) + sizeof(DECP_COUNTER_SPARE) +
+           decp_counter_pages(sectors) * sizeof(DECP_COUNTER_PAGE);
+}
+
+
+dec_counter_store_result dec_counter_store_open(void* region, unsigned long long size, unsigned long long sectors,
+                                                bcmlib_flush_routine flush, void* user_context,
+                                                DEC_COUNTER_STORE* store)
+{
+    const DECP_COUNTER_STORE_HEADER* header = (const DECP_COUNTER_STORE_HEADER*)region;
+
+    if (!sectors || size < dec_counter_store_region_size(sectors))
+    {
+        return dec_counter_store_invalid;
+    }
+
+    if (!header->magic)
+    {
+        return dec_counter_store_format(region, size, sectors, flush, user_context, store);
+    }
+
+    if (header->magic != DECP_COUNTER_STORE_MAGIC ||
+        header->version != DECP_COUNTER_STORE_VERSION ||
+        header->sectors != sectors ||
+        header->page_sectors != DECP_COUNTER_PAGE_SECTORS ||
+        header->batch_size != BCMLIB_DEC_COUNTER_BATCH_SIZE)
+    {
+        return dec_counter_store_invalid;
+    }
+
+    decp_counter_store_init(region, sectors, flush, user_context, store);
+    decp_counter_recover(store);
+
+    return dec_counter_store_ok;
+}
+
+
+dec_counter_store_result dec_counter_store_format(void* region, unsigned long long size, unsigned long long sectors,
+                                                  bcmlib_flush_routine flush, void* user_context,
+                                                  DEC_COUNTER_STORE* store)
+{
+    DECP_COUNTER_STORE_HEADER* header = (DECP_COUNTER_STORE_HEADER*)region;
+    unsigned long long* words         = (unsigned long long*)region;
+    unsigned long long idx;
+
+    if (!sectors || size < dec_counter_store_region_size(sectors))
+    {
+        return dec_counter_store_invalid;
+    }
+
+    decp_counter_store_init(region, sectors, flush, user_context, store);
+
+    //
+    // Magic is written (and flushed) last, so a region
+    // torn by a crash is formatted again on open
+    //
+
+    header->magic = 0;
+    decp_counter_flush(store, &header->magic, sizeof(header->magic));
+
+    for (idx = 0; idx < dec_counter_store_region_size(sectors) / sizeof(unsigned long long); ++idx)
+    {
+        words[idx] = 0;
+    }
+
+    header->version      = DECP_COUNTER_STORE_VERSION;
+    header->sectors      = sectors;
+    header->page_sectors = DECP_COUNTER_PAGE_SECTORS;
+    header->batch_size   = BCMLIB_DEC_COUNTER_BATCH_SIZE;
+
+    decp_counter_flush(store, region, dec_counter_store_region_size(sectors));
+
+    header->magic = DECP_COUNTER_STORE_MAGIC;
+    decp_counter_flush(store, &header->magic, sizeof(header->magic));
+
+    return dec_counter_store_ok;
+}
+
+
+dec_counter_store_result dec_counter_store_get(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                               unsigned long long* counter)
+{
+    unsigned long idx;
+
+    if (sector >= store->sectors)
+    {
+        return dec_counter_store_invalid;
+    }
+
+    bcmlib_spinlock_acquire(&store->lock);
+
+    idx      = decp_counter_find(store, sector);
+    *counter = idx < store->pending
+             ? store->batch[idx].counter
+             : decp_counter_read(store, sector);
+
+    bcmlib_spinlock_release(&store->lock);
+
+    return dec_counter_store_ok;
+}
+
+
+dec_counter_store_result dec_counter_store_next(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                                unsigned long long* counter)
+{
+    *counter = 0;
+
+    return decp_counter_record(store, sector, counter);
+}
+
+
+dec_counter_store_result dec_counter_store_set(DEC_COUNTER_STORE* store, unsigned long long sector,
+                                               unsigned long long counter)
+{
+    if (!counter)
+    {
+        return dec_counter_store_invalid;
+    }
+
+    return decp_counter_record(store, sector, &counter);
+}
+
+
+void dec_counter_store_commit(DEC_COUNTER_STORE* store)
+{
+    DECP_COUNTER_JOURNAL* journal = decp_counter_journal(store);
+    unsigned long committing;
+    unsigned long pages;
+    unsigned long idx;
+
+    const DECP_COUNTER_PAGE* rebase[BCMLIB_DEC_COUNTER_BATCH_SIZE];
+
+    bcmlib_spinlock_acquire(&store->commit_lock);
+
+    bcmlib_spinlock_acquire(&store->lock);
+
+    committing        = store->pending;
+    store->committing = committing;
+
+    bcmlib_spinlock_release(&store->lock);
+
+    if (!committing)
+    {
+        bcmlib_spinlock_release(&store->commit_lock);
+        return;
+    }
+
+    //
+    // Counters, that are being committed, are not modified by
+    // other threads, so they are copied without the lock
+    //
+
+    for (idx = 0; idx < committing; ++idx)
+    {
+        journal->counters[idx] = store->batch[idx];
+    }
+
+    journal->count    = committing;
+    journal->checksum = decp_counter_journal_checksum(journal);
+
+    decp_counter_flush(store, journal, sizeof(*journal));
+
+    //
+    // Pages are updated under the lock, because other threads read
+    // them while allocating counters. Rebasing flushes the region, so
+    // it is done after the lock is released: the lock guards single
+    // page copies only, allocating threads never wait for I/O
+    //
+
+    bcmlib_spinlock_acquire(&store->lock);
+
+    pages = decp_counter_apply(store, journal, rebase);
+
+    for (idx = committing; idx < store->pending; ++idx)
+    {
+        store->batch[idx - committing] = store->batch[idx];
+    }
+
+    store->pending   -= committing;
+    store->committing = 0;
+
+    bcmlib_spinlock_release(&store->lock);
+
+    decp_counter_flush_pages(store, journal);
+    decp_counter_rebase_pages(store, rebase, pages);
+
+    //
+    // Journal may be applied again, so it is not flushed here:
+    // the next commit overwrites it anyway
+    //
+
+    journal->count = 0;
+
+    bcmlib_spinlock_release(&store->commit_lock);
+}
+
+
+void dec_context_init(const KEY* master_key, unsigned long long master_key_id,
+                      DEC_CONTEXT* context, const BLOCK_CIPHER* cipher)
+{
+    context->master_key     = master_key;
+    context->master_key_id  = master_key_id;
+    context->cipher         = cipher;
+    context->partition_keys = NULL;
+    context->sector_keys    = NULL;
+    context->keystreams     = NULL;
+    context->key_store      = NULL;
+}
+
+
+void dec_encrypt_context(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long sector, unsigned long long sector_counter,
+                         const unsigned char* in, unsigned long blocks, const DEC_CONTEXT* context,
+                         unsigned char* out)
+{
+    KEY partition_key;
+
+    int partition_key_ready = 0;
+
+    decp_process_sector(partition, partition_counter, sector, sector_counter, in, blocks,
+                        context, &partition_key, &partition_key_ready, out);
+}
+
+
+void dec_decrypt_context(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long sector, unsigned long long sector_counter,
+                         const unsigned char* in, unsigned long blocks, const DEC_CONTEXT* context,
+                         unsigned char* out)
+{
+    dec_encrypt_context(partition, partition_counter, sector, sector_counter,
+                        in, blocks, context, out);
+}
+
+
+void dec_encrypt_sectors_context(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const DEC_CONTEXT* context, unsigned char* out)
+{
+    unsigned long long offset = 0;
+    unsigned long sector;
+
+    KEY partition_key;
+
+    int partition_key_ready = 0;
+
+    //
+    // Partition key is common for all sectors, so it is obtained
+    // once (and only if some sector key is not cached). Then each
+    // sector needs its own key and its own keystream.
+    //
+
+    for (sector = 0; sector < sectors; ++sector, offset += (unsigned long long)blocks * context->cipher->block_size)
+    {
+        decp_process_sector(partition, partition_counter, first_sector + sector, sector_counters[sector],
+                            in + offset, blocks, context, &partition_key, &partition_key_ready, out + offset);
+    }
+}
+
+
+void dec_decrypt_sectors_context(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const DEC_CONTEXT* context, unsigned char* out)
+{
+    dec_encrypt_sectors_context(partition, partition_counter, first_sector, sectors,
+                                sector_counters, in, blocks, context, out);
+}
+
+
+void dec_encrypt_sectors(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long first_sector, unsigned long sectors,
+                         const unsigned long long* sector_counters, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* master_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_master_key;
+    decp_initialize_key(master_key, &internal_master_key, cipher);
+
+    dec_encrypt_sectors_perform(partition, partition_counter, first_sector, sectors, sector_counters,
+                                in, blocks, &internal_master_key, out, cipher);
+}
+
+
+void dec_encrypt_sectors_perform(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const KEY* master_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    DEC_CONTEXT context;
+    dec_context_init(master_key, 0, &context, cipher);
+
+    dec_encrypt_sectors_context(partition, partition_counter, first_sector, sectors,
+                                sector_counters, in, blocks, &context, out);
+}
+
+
+void dec_decrypt_sectors(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long first_sector, unsigned long sectors,
+                         const unsigned long long* sector_counters, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* master_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_master_key;
+    decp_initialize_key(master_key, &internal_master_key, cipher);
+
+    dec_decrypt_sectors_perform(partition, partition_counter, first_sector, sectors, sector_counters,
+                                in, blocks, &internal_master_key, out, cipher);
+}
+
+
+void dec_decrypt_sectors_perform(unsigned long long partition, unsigned long long partition_counter,
+                                 unsigned long long first_sector, unsigned long sectors,
+                                 const unsigned long long* sector_counters, const unsigned char* in,
+                                 unsigned long blocks, const KEY* master_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    dec_encrypt_sectors_perform(partition, partition_counter, first_sector, sectors,
+                                sector_counters, in, blocks, master_key, out, cipher);
+}
+
+
+void dec_sector_key(unsigned long long partition, unsigned long long partition_counter,
+                    unsigned long long sector, unsigned long long sector_counter,
+                    unsigned long sector_blocks, const DEC_CONTEXT* context, KEY* out)
+{
+    KEY partition_key;
+
+    int partition_key_ready = 0;
+
+    decp_sector_key(partition, partition_counter, sector, sector_counter, sector_blocks,
+                    context, &partition_key, &partition_key_ready, out);
+}
+
+
+void dec_encrypt_blocks_context(unsigned long long partition, unsigned long long partition_counter,
+                                unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const DEC_CONTEXT* context, unsigned char* out)
+{
+    KEY sector_key;
+
+    dec_sector_key(partition, partition_counter, sector, sector_counter,
+                   sector_blocks, context, &sector_key);
+
+    dec_encrypt_blocks_perform(sector, sector_counter, sector_blocks, first_block,
+                               in, blocks, &sector_key, out, context->cipher);
+}
+
+
+void dec_decrypt_blocks_context(unsigned long long partition, unsigned long long partition_counter,
+                                unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const DEC_CONTEXT* context, unsigned char* out)
+{
+    dec_encrypt_blocks_context(partition, partition_counter, sector, sector_counter,
+                               sector_blocks, first_block, in, blocks, context, out);
+}
+
+
+void dec_encrypt_blocks_perform(unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const KEY* sector_key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    //
+    // Counter of each block depends on its index only,
+    // so the range is processed without the rest of the sector
+    //
+
+    decp_gamma(sector, sector_counter * sector_blocks + first_block, in, blocks, sector_key, out, cipher);
+}
+
+
+void dec_decrypt_blocks_perform(unsigned long long sector, unsigned long long sector_counter,
+                                unsigned long sector_blocks, unsigned long first_block,
+                                const unsigned char* in, unsigned long blocks,
+                                const KEY* sector_key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    dec_encrypt_blocks_perform(sector, sector_counter, sector_blocks, first_block,
+                               in, blocks, sector_key, out, cipher);
+}
+
+
+void dec_encrypt(unsigned long long partition, unsigned long long partition_counter,
+                 unsigned long long sector, unsigned long long sector_counter,
+                 const unsigned char* in, unsigned long blocks, const unsigned char* master_key,
+                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_master_key;
+    decp_initialize_key(master_key, &internal_master_key, cipher);
+
+    dec_encrypt_perform(partition, partition_counter, sector, sector_counter,
+                        in, blocks, &internal_master_key, out, cipher);
+}
+
+
+void dec_encrypt_perform(unsigned long long partition, unsigned long long partition_counter,
+                         unsigned long long sector, unsigned long long sector_counter,
+                         const unsigned char* in, unsigned long blocks, const KEY* master_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    DEC_CONTEXT context;
+    dec_context_init(master_key, 0, &context, cipher);
+
+    dec_encrypt_context(partition, partition_counter, sector, sector_counter,
+                        in, blocks, &context, out);
 }
 
 
@@ -5,6 +5,7 @@
 
 #include "modes/heh/heh.h"
 #include "common/utils.h"
+#include "common/cpu.h"
 #include "bclib.h"
 #include "galoislib.h"
 
@@ -12,139 +13,384 @@
 
 
 /**
- * @brief Initialize HEH tweaks.
+ * @brief Number of blocks folded into the hash with a single reduction.
  */
-BCMLIB_FORCEINLINE void hehp_tweaks_init(unsigned long long tweak, const KEY* key,
-                                         __m128i* tau, __m128i* beta,
-                                         const BLOCK_CIPHER* cipher)
+#define HEHP_AGGREGATED_BLOCKS 8
+
+
+/**
+ * @brief Number of sectors processed in lockstep.
+ * 
+ * Hash chains and cipher calls of different sectors are independent,
+ * so interleaving them keeps execution ports busy. State of each sector
+ * takes about half a kilobyte of stack, so kernel builds use fewer.
+ */
+#if defined(_KERNEL_MODE)
+#define HEHP_PARALLEL_SECTORS 4
+#else
+#define HEHP_PARALLEL_SECTORS 8
+#endif  // _KERNEL_MODE
+
+
+/**
+ * @brief Direction of a block cipher in ECB stage.
+ */
+typedef enum tagHEHP_DIRECTION
+{
+    hehp_encrypt,
+    hehp_decrypt
+} HEHP_DIRECTION;
+
+
+/**
+ * @brief Powers of tau used by polynomial hash.
+ */
+typedef struct tagHEHP_HASH_KEY
+{
+    __m128i powers[HEHP_AGGREGATED_BLOCKS];  /**< tau, tau^2, ..., tau^8 */
+    int aggregated;                          /**< non-zero if carry-less multiplication is available */
+} HEHP_HASH_KEY;
+
+
+/**
+ * @brief State of a sector in a pass of `hehp_process`.
+ */
+typedef struct tagHEHP_SECTOR_STATE
+{
+    __m128i tau;                                /**< Encrypted tweak */
+    __m128i beta;                               /**< tau * x */
+    __m128i Y;                                  /**< Y of psi */
+    __m128i Y_inverse;                          /**< Y of inverse of psi */
+    __m128i last;                               /**< Unmasked ECB output of the last block */
+    __m128i accumulated_tweak;                  /**< Mask of the next block */
+    __m128i tweaks[HEHP_AGGREGATED_BLOCKS];     /**< Masks of blocks in a window */
+    __m128i temporary[HEHP_AGGREGATED_BLOCKS];  /**< Blocks of a window */
+    HEHP_HASH_KEY hash_key;                     /**< Powers of tau */
+} HEHP_SECTOR_STATE;
+
+
+/**
+ * @brief Initialize HEH tweaks of `sectors` consecutive sectors.
+ */
+BCMLIB_FORCEINLINE void hehp_tweaks_init(unsigned long long first_tweak, unsigned long sectors, const KEY* key,
+                                         HEHP_SECTOR_STATE* state, const BLOCK_CIPHER* cipher)
 {
-    __m128i internal_tweak;
-    unsigned int idx;
-    BCMLIB_ALIGN16 unsigned char internal_tweak_bytes[MAX_BLOCK_SIZE];
+    unsigned long sector;
 
-    for (idx = 0; idx < sizeof(internal_tweak_bytes); ++idx)
+    //
+    // Tweak is a little-endian number padded with zeros up to a block.
+    // Encryptions of tweaks are independent, so they go in a batch.
+    //
+
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        cipher->encrypt_block(_mm_set_epi64x(0, (long long)(first_tweak + sector)), key, &state[sector].tau);
+    }
+
+    for (sector = 0; sector < sectors; ++sector)
     {
-        internal_tweak_bytes[idx] = (unsigned char)(tweak & 0xFF);
-        tweak >>= 8;
+        state[sector].beta = gf128_multiply_primitive(state[sector].tau);
     }
+}
+
+
+/**
+ * @brief Initializes hash key: precomputes as many powers of tau,
+ *        as can be used for a hash of `blocks` blocks.
+ */
+BCMLIB_FORCEINLINE void hehp_hash_key_init(__m128i tau, unsigned long long blocks, HEHP_HASH_KEY* hash_key)
+{
+    unsigned long long power;
 
-    internal_tweak = _mm_load_si128((const __m128i*)internal_tweak_bytes);
+    hash_key->powers[0]  = tau;
+    hash_key->aggregated = (bcmlib_cpu_features() & BCMLIB_CPU_PCLMULQDQ) != 0;
 
-    cipher->encrypt_block(internal_tweak, key, tau);
-    *beta = gf128_multiply_primitive(*tau);
+    if (!hash_key->aggregated)
+    {
+        return;
+    }
+
+    for (power = 1; power < HEHP_AGGREGATED_BLOCKS && power < blocks; ++power)
+    {
+        hash_key->powers[power] = gf128_multiply(hash_key->powers[power - 1], tau);
+    }
 }
 
 
 /**
- * @brief Apply psi permutation.
+ * @brief Accumulates unreduced 256-bit product of a and b into (lo, mid, hi).
  */
-BCMLIB_FORCEINLINE void hehp_apply_psi(const __m128i* in, unsigned long blocks,
-                                       __m128i tau, __m128i beta, __m128i* out)
+BCMLIB_FORCEINLINE BCMLIB_TARGET_PCLMULQDQ void hehp_clmul_accumulate(__m128i a, __m128i b, __m128i* lo, __m128i* mid, __m128i* hi)
 {
-    //
-    // Implementation of psi permutation:
-    // psi(x[1], ..., x[n]) = (x[1] + Y, ..., x[n-1] + Y, Y) + e
-    //
-    // Y = x[n] + x[n - 1] * tau + ... + x[1] * tau ^ {n - 1}
-    // e = (a * beta, ..., a ^ {n - 1} * tweak, tweak)
-    //
+    *lo  = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+    *hi  = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+    *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x01));
+    *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x10));
+}
 
-    __m128i Y;
-    __m128i accumulated_tweak;
-    unsigned int block;
 
+/**
+ * @brief Reduces 256-bit product (lo, mid, hi) modulo x^128 + x^7 + x^2 + x + 1.
+ */
+BCMLIB_FORCEINLINE BCMLIB_TARGET_PCLMULQDQ __m128i hehp_clmul_reduce(__m128i lo, __m128i mid, __m128i hi)
+{
     //
-    // Calculate Y value of psi
+    // Bit i of a value is a coefficient of x^i (the same representation,
+    // as used by `gf128_multiply`). Since x^128 = x^7 + x^2 + x + 1, high
+    // part is folded into low one by multiplication by 0x87, what is done
+    // twice, because the first fold overflows by 7 bits.
     //
 
-    Y = _mm_setzero_si128();
+    const __m128i polynomial = _mm_set_epi64x(0, 0x87);
+
+    __m128i folded;
+
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    lo     = _mm_xor_si128(lo, _mm_clmulepi64_si128(hi, polynomial, 0x00));
+    folded = _mm_clmulepi64_si128(hi, polynomial, 0x01);
+    lo     = _mm_xor_si128(lo, _mm_slli_si128(folded, 8));
+    lo     = _mm_xor_si128(lo, _mm_clmulepi64_si128(_mm_srli_si128(folded, 8), polynomial, 0x00));
+
+    return lo;
+}
+
+
+/**
+ * @brief Absorbs blocks into hash using aggregated reduction:
+ *        (H + x[1]) * tau^k + x[2] * tau^{k - 1} + ... + x[k] * tau
+ *        is calculated with a single reduction for up to 8 blocks.
+ */
+BCMLIB_TARGET_PCLMULQDQ __m128i hehp_hash_update_aggregated(__m128i H, const __m128i* in, unsigned long long blocks,
+                                                             const HEHP_HASH_KEY* hash_key)
+{
+    unsigned long long window;
+    unsigned long long block;
 
-    for (block = 0; block < blocks - 1; ++block)
+    __m128i lo;
+    __m128i mid;
+    __m128i hi;
+
+    while (blocks)
     {
-        Y = _mm_xor_si128(Y, in[block]);
-        Y = gf128_multiply(Y, tau);
+        window = (blocks < HEHP_AGGREGATED_BLOCKS) ? blocks : HEHP_AGGREGATED_BLOCKS;
+
+        lo  = _mm_setzero_si128();
+        mid = _mm_setzero_si128();
+        hi  = _mm_setzero_si128();
+
+        hehp_clmul_accumulate(_mm_xor_si128(H, in[0]), hash_key->powers[window - 1], &lo, &mid, &hi);
+
+        for (block = 1; block < window; ++block)
+        {
+            hehp_clmul_accumulate(in[block], hash_key->powers[window - block - 1], &lo, &mid, &hi);
+        }
+
+        H = hehp_clmul_reduce(lo, mid, hi);
+
+        in += window;
+        blocks -= window;
     }
 
-    //
-    // Finally add the last block
-    //
+    return H;
+}
 
-    Y = _mm_xor_si128(Y, in[blocks - 1]);
 
-    //
-    // Apply psi transformation
-    //
+/**
+ * @brief Absorbs blocks into hash: H = (...((H + x[1]) * tau + x[2]) * tau + ... + x[k]) * tau.
+ */
+BCMLIB_FORCEINLINE __m128i hehp_hash_update(__m128i H, const __m128i* in, unsigned long long blocks, const HEHP_HASH_KEY* hash_key)
+{
+    unsigned long long block;
 
-    accumulated_tweak = gf128_multiply_primitive(beta);
+    if (hash_key->aggregated)
+    {
+        return hehp_hash_update_aggregated(H, in, blocks, hash_key);
+    }
 
-    for (block = 0; block < blocks - 1; ++block)
+    for (block = 0; block < blocks; ++block)
     {
-        out[block]        = _mm_xor_si128(in[block], Y);
-        out[block]        = _mm_xor_si128(out[block], accumulated_tweak);
-        accumulated_tweak = gf128_multiply_primitive(accumulated_tweak);
+        H = _mm_xor_si128(H, in[block]);
+        H = gf128_multiply(H, hash_key->powers[0]);
     }
 
-    out[blocks - 1] = _mm_xor_si128(Y, beta);
+    return H;
 }
 
 
 /**
- * @brief Apply inverse of psi permutation.
+ * @brief Encrypts or decrypts a single block.
  */
-BCMLIB_FORCEINLINE void hehp_apply_psi_inverse(const __m128i* in, unsigned long blocks,
-                                               __m128i tau, __m128i beta, __m128i* out)
+BCMLIB_FORCEINLINE void hehp_crypt_block(__m128i* block, const KEY* key, HEHP_DIRECTION direction, const BLOCK_CIPHER* cipher)
 {
-    //
-    // Implementation of inverse of psi
-    //
+    if (direction == hehp_encrypt)
+    {
+        cipher->encrypt_block(*block, key, block);
+    }
+    else
+    {
+        cipher->decrypt_block(*block, key, block);
+    }
+}
+
+
+/**
+ * @brief Applies psi, ECB and inverse of psi to up to `HEHP_PARALLEL_SECTORS`
+ *        consecutive sectors in a single streaming pass.
+ * 
+ * Psi output is never stored: each window of blocks is masked, goes
+ * through the cipher, is unmasked and absorbed into Y of inverse psi
+ * while in registers, so every output block is written once. It is
+ * possible, because the last block of psi output depends on Y only,
+ * hence the last block of ECB output, that inverse of psi adds to each
+ * block, is computed before all others. The only other pass is a
+ * read-only hashing of input, because Y of psi depends on all blocks.
+ * 
+ * Sector `s` is located at `in + s * blocks`. All stages advance
+ * sectors in lockstep. State is provided by a caller and MUST hold
+ * `sectors` elements, so single-sector calls stay small on stack.
+ */
+BCMLIB_FORCEINLINE void hehp_process(unsigned long long first_tweak, unsigned long sectors, const __m128i* in,
+                                     unsigned long long blocks, const KEY* data_key, const KEY* tweak_key,
+                                     HEHP_DIRECTION direction, __m128i* out, HEHP_SECTOR_STATE* state,
+                                     const BLOCK_CIPHER* cipher)
+{
+    unsigned long long window;
+    unsigned long long offset;
+    unsigned long long block;
+    unsigned long sector;
 
-    __m128i Y;
-    __m128i accumulated_tweak;
-    __m128i temp;
-    unsigned int block;
+    hehp_tweaks_init(first_tweak, sectors, tweak_key, state, cipher);
+
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        hehp_hash_key_init(state[sector].tau, blocks, &state[sector].hash_key);
+    }
 
     //
-    // Firstly remove mask
+    // Y of psi:
+    // Y = x[n] + x[n - 1] * tau + ... + x[1] * tau ^ {n - 1}
     //
 
-    accumulated_tweak = gf128_multiply_primitive(beta);
-
-    for (block = 0; block < blocks - 1; ++block)
+    for (sector = 0; sector < sectors; ++sector)
     {
-        out[block]        = _mm_xor_si128(in[block], accumulated_tweak);
-        accumulated_tweak = gf128_multiply_primitive(accumulated_tweak);
+        state[sector].Y = _mm_setzero_si128();
     }
 
-    out[blocks - 1] = _mm_xor_si128(in[blocks - 1], beta);
+    for (offset = 0; offset < blocks - 1; offset += window)
+    {
+        window = (blocks - 1 - offset < HEHP_AGGREGATED_BLOCKS) ? blocks - 1 - offset : HEHP_AGGREGATED_BLOCKS;
+
+        for (sector = 0; sector < sectors; ++sector)
+        {
+            state[sector].Y = hehp_hash_update(state[sector].Y, in + sector * blocks + offset, window, &state[sector].hash_key);
+        }
+    }
 
     //
-    // Now recover n - 1 blocks
+    // The last block goes first: psi gives Y + beta, ECB is applied
+    // and the result is unmasked as in inverse of psi
     //
 
-    temp = out[blocks - 1];
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        state[sector].Y    = _mm_xor_si128(state[sector].Y, in[sector * blocks + blocks - 1]);
+        state[sector].last = _mm_xor_si128(state[sector].Y, state[sector].beta);
+    }
+
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        hehp_crypt_block(&state[sector].last, data_key, direction, cipher);
+    }
 
-    for (block = 0; block < blocks - 1; ++block)
+    for (sector = 0; sector < sectors; ++sector)
     {
-        out[block] = _mm_xor_si128(out[block], temp);
+        state[sector].last              = _mm_xor_si128(state[sector].last, state[sector].beta);
+        state[sector].Y_inverse         = _mm_setzero_si128();
+        state[sector].accumulated_tweak = gf128_multiply_primitive(state[sector].beta);
     }
 
     //
-    // Now recover the last one
+    // Fused pass over the first n - 1 blocks of each sector. Note,
+    // that `last` is kept in state, so in-place operation is safe:
+    // the last block of a sector is written at the very end.
     //
 
-    Y = _mm_setzero_si128();
-
-    for (block = 0; block < blocks - 1; ++block)
+    for (offset = 0; offset < blocks - 1; offset += window)
     {
-        Y = _mm_xor_si128(Y, out[block]);
-        Y = gf128_multiply(Y, tau);
+        window = (blocks - 1 - offset < HEHP_AGGREGATED_BLOCKS) ? blocks - 1 - offset : HEHP_AGGREGATED_BLOCKS;
+
+        for (sector = 0; sector < sectors; ++sector)
+        {
+            for (block = 0; block < window; ++block)
+            {
+                state[sector].tweaks[block]     = state[sector].accumulated_tweak;
+                state[sector].temporary[block]  = _mm_xor_si128(in[sector * blocks + offset + block], state[sector].Y);
+                state[sector].temporary[block]  = _mm_xor_si128(state[sector].temporary[block], state[sector].accumulated_tweak);
+                state[sector].accumulated_tweak = gf128_multiply_primitive(state[sector].accumulated_tweak);
+            }
+        }
+
+        for (sector = 0; sector < sectors; ++sector)
+        {
+            for (block = 0; block < window; ++block)
+            {
+                hehp_crypt_block(&state[sector].temporary[block], data_key, direction, cipher);
+            }
+        }
+
+        for (sector = 0; sector < sectors; ++sector)
+        {
+            for (block = 0; block < window; ++block)
+            {
+                state[sector].temporary[block] = _mm_xor_si128(state[sector].temporary[block], state[sector].tweaks[block]);
+                state[sector].temporary[block] = _mm_xor_si128(state[sector].temporary[block], state[sector].last);
+
+                out[sector * blocks + offset + block] = state[sector].temporary[block];
+            }
+
+            state[sector].Y_inverse = hehp_hash_update(state[sector].Y_inverse, state[sector].temporary,
+                                                       window, &state[sector].hash_key);
+        }
     }
 
     //
-    // Finally add the pre-last block and recover the last one
+    // Last block fix-up
     //
 
-    out[blocks - 1] = _mm_xor_si128(out[blocks - 1], Y);
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        out[sector * blocks + blocks - 1] = _mm_xor_si128(state[sector].last, state[sector].Y_inverse);
+    }
+}
+
+
+/**
+ * @brief Processes any number of consecutive sectors in batches.
+ */
+BCMLIB_FORCEINLINE void hehp_process_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                             unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                             HEHP_DIRECTION direction, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    unsigned long batch;
+
+    HEHP_SECTOR_STATE state[HEHP_PARALLEL_SECTORS];
+
+    const __m128i* internal_in = (const __m128i*)in;
+    __m128i* internal_out      = (__m128i*)out;
+
+    while (sectors)
+    {
+        batch = (sectors < HEHP_PARALLEL_SECTORS) ? sectors : HEHP_PARALLEL_SECTORS;
+
+        hehp_process(first_tweak, batch, internal_in, blocks, data_key, tweak_key, direction, internal_out, state, cipher);
+
+        internal_in += batch * blocks;
+        internal_out += batch * blocks;
+        first_tweak += batch;
+        sectors -= batch;
+    }
 }
 
 
@@ -161,41 +407,53 @@ void heh_encrypt(unsigned long long tweak, const unsigned char* in, unsigned lon
 void heh_encrypt_perform(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
                          const KEY* key, unsigned char* out, const BLOCK_CIPHER* cipher)
 {
-    unsigned int block;
+    HEHP_SECTOR_STATE state;
+    hehp_process(tweak, 1, (const __m128i*)in, blocks, key, key, hehp_encrypt, (__m128i*)out, &state, cipher);
+}
 
-    __m128i tau;
-    __m128i beta;
 
-    const __m128i* internal_in = (const __m128i*)in;
-    __m128i* internal_out      = (__m128i*)out;
+void heh_decrypt(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
+                 const unsigned char* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
 
-    hehp_tweaks_init(tweak, key, &tau, &beta, cipher);
+    cipher->initialize_decrypt_key(key, &internal_data_key);
+    cipher->initialize_encrypt_key(key, &internal_tweak_key);
 
-    //
-    // First hash stage
-    //
+    heh_decrypt_perform(tweak, in, blocks, &internal_data_key,
+                        &internal_tweak_key, out, cipher);
+}
 
-    hehp_apply_psi(internal_in, blocks, tau, beta, internal_out);
 
-    //
-    // ECB encryption
-    //
+void heh_decrypt_perform(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
+                         const KEY* data_key, const KEY* tweak_key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    HEHP_SECTOR_STATE state;
+    hehp_process(tweak, 1, (const __m128i*)in, blocks, data_key, tweak_key, hehp_decrypt, (__m128i*)out, &state, cipher);
+}
 
-    for (block = 0; block < blocks; ++block)
-    {
-        cipher->encrypt_block(internal_out[block], key, &internal_out[block]);
-    }
 
-    //
-    // Second hash stage
-    //
+void heh_encrypt_large(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                       const unsigned char* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
 
-    hehp_apply_psi_inverse(internal_out, blocks, tau, beta, internal_out);
+    heh_encrypt_large_perform(tweak, in, blocks, &internal_key, out, cipher);
 }
 
 
-void heh_decrypt(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
-                 const unsigned char* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+void heh_encrypt_large_perform(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                               const KEY* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    HEHP_SECTOR_STATE state;
+    hehp_process(tweak, 1, (const __m128i*)in, blocks, key, key, hehp_encrypt, (__m128i*)out, &state, cipher);
+}
+
+
+void heh_decrypt_large(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                       const unsigned char* key, unsigned char* out, const BLOCK_CIPHER* cipher)
 {
     KEY internal_data_key;
     KEY internal_tweak_key;
@@ -203,42 +461,53 @@ void heh_decrypt(unsigned long long tweak, const unsigned char* in, unsigned lon
     cipher->initialize_decrypt_key(key, &internal_data_key);
     cipher->initialize_encrypt_key(key, &internal_tweak_key);
 
-    heh_decrypt_perform(tweak, in, blocks, &internal_data_key,
-                        &internal_tweak_key, out, cipher);
+    heh_decrypt_large_perform(tweak, in, blocks, &internal_data_key,
+                              &internal_tweak_key, out, cipher);
 }
 
 
-void heh_decrypt_perform(unsigned long long tweak, const unsigned char* in, unsigned long blocks,
-                         const KEY* data_key, const KEY* tweak_key, unsigned char* out, const BLOCK_CIPHER* cipher)
+void heh_decrypt_large_perform(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                               const KEY* data_key, const KEY* tweak_key, unsigned char* out, const BLOCK_CIPHER* cipher)
 {
-    unsigned int block;
+    HEHP_SECTOR_STATE state;
+    hehp_process(tweak, 1, (const __m128i*)in, blocks, data_key, tweak_key, hehp_decrypt, (__m128i*)out, &state, cipher);
+}
 
-    __m128i tau;
-    __m128i beta;
 
-    const __m128i* internal_in = (const __m128i*)in;
-    __m128i* internal_out      = (__m128i*)out;
+void heh_encrypt_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
 
-    hehp_tweaks_init(tweak, tweak_key, &tau, &beta, cipher);
+    heh_encrypt_sectors_perform(first_tweak, sectors, in, blocks, &internal_key, out, cipher);
+}
 
-    //
-    // First hash stage
-    //
 
-    hehp_apply_psi(internal_in, blocks, tau, beta, internal_out);
+void heh_encrypt_sectors_perform(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    hehp_process_sectors(first_tweak, sectors, in, blocks, key, key, hehp_encrypt, out, cipher);
+}
 
-    //
-    // ECB decryption
-    //
 
-    for (block = 0; block < blocks; ++block)
-    {
-        cipher->decrypt_block(internal_out[block], data_key, &internal_out[block]);
-    }
+void heh_decrypt_sectors(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* key, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
 
-    //
-    // Second hash stage
-    //
+    cipher->initialize_decrypt_key(key, &internal_data_key);
+    cipher->initialize_encrypt_key(key, &internal_tweak_key);
+
+    heh_decrypt_sectors_perform(first_tweak, sectors, in, blocks, &internal_data_key,
+                                &internal_tweak_key, out, cipher);
+}
 
-    hehp_apply_psi_inverse(internal_out, blocks, tau, beta, internal_out);
+
+void heh_decrypt_sectors_perform(unsigned long long first_tweak, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    hehp_process_sectors(first_tweak, sectors, in, blocks, data_key, tweak_key, hehp_decrypt, out, cipher);
 }
@@ -0,0 +1,441 @@
+/**
+ * @file pmac.c
+ * @brief PMAC mode of operation implementation
+ */
+
+#include "modes/pmac/pmac.h"
+#include "common/utils.h"
+#include "bclib.h"
+
+#include <immintrin.h>
+#include <smmintrin.h>
+
+
+/**
+ * @brief Number of independent blocks passed to the cipher one after another.
+ */
+#define PMACP_PARALLEL_BLOCKS 8
+
+
+/**
+ * @brief Maximal number of offset levels: block index never
+ *        has more significant bits, than `unsigned long` has.
+ */
+#define PMACP_MAX_LEVELS (sizeof(unsigned long) * 8)
+
+
+/**
+ * @brief Maximal number of tasks of parallel digest calculation.
+ */
+#define PMACP_MAX_TASKS 32
+
+
+/**
+ * @brief Offsets of PMAC. L(k) = L * x^k, where L = Encrypt(K, 0...0).
+ */
+typedef struct tagPMACP_OFFSETS
+{
+    __m128i L[PMACP_MAX_LEVELS]; /**< L(k) for each level k in use */
+
+    __m128i L_inverse; /**< L * x^(-1), masks the last block */
+} PMACP_OFFSETS;
+
+
+/**
+ * @brief Context of parallel digest calculation.
+ */
+typedef struct tagPMACP_PARALLEL_CONTEXT
+{
+    const unsigned char* in; /**< Input message */
+
+    unsigned long blocks; /**< Number of blocks to process (except the last one) */
+
+    unsigned long chunk_blocks; /**< Number of blocks processed by a single task */
+
+    const PMACP_OFFSETS* offsets; /**< Offsets of PMAC */
+
+    const KEY* key; /**< MAC key */
+
+    __m128i* sums; /**< Partial sums, one per task */
+
+    const BLOCK_CIPHER* cipher; /**< Block cipher instance */
+} PMACP_PARALLEL_CONTEXT;
+
+
+/**
+ * @brief Mask that truncates a tag
+ */
+BCMLIB_FORCEINLINE __m128i pmacp_mask(unsigned long significant_bits)
+{
+    //
+    // Just lookup for predefined values
+    //
+
+    switch (significant_bits)
+    {
+    case BCMLIB_PMAC_TAG_SIZE_64:
+        return _mm_setr_epi32(0xffffffff, 0xffffffff, 0x00000000, 0x00000000);
+
+    case BCMLIB_PMAC_TAG_SIZE_128:
+        return _mm_setr_epi32(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff);
+
+    default:
+        return _mm_setr_epi32(0x00000000, 0x00000000, 0x00000000, 0x00000000);
+    }
+}
+
+
+/**
+ * @brief Multiplies a value by x: shifts it left by one bit treating it as
+ *        a big-endian 128-bit value and adds B128, if MSB was set.
+ */
+BCMLIB_FORCEINLINE __m128i pmacp_double(__m128i in)
+{
+    //
+    // The same as CMAC subkey derivation: reverse bytes, shift halves
+    // and propagate carries multiplied by (1, 0x87)
+    //
+
+    const __m128i reverse    = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i polynomial = _mm_setr_epi32(0x87, 0x00, 0x01, 0x00);
+
+    __m128i carry;
+
+    in    = _mm_shuffle_epi8(in, reverse);
+    carry = _mm_shuffle_epi32(_mm_srli_epi64(in, 63), 0x4E);
+
+    in = _mm_slli_epi64(in, 1);
+    in = _mm_xor_si128(in, _mm_mul_epu32(carry, polynomial));
+
+    return _mm_shuffle_epi8(in, reverse);
+}
+
+
+/**
+ * @brief Multiplies a value by x^(-1): shifts it right by one bit treating it
+ *        as a big-endian 128-bit value and adds 10...01000011, if LSB was set.
+ */
+BCMLIB_FORCEINLINE __m128i pmacp_half(__m128i in)
+{
+    //
+    // Bit 0 of the high half goes to bit 63 of the low half,
+    // bit 0 of the value is reduced: x^(-1) = x^127 + x^6 + x + 1
+    //
+
+    const __m128i reverse    = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i polynomial = _mm_setr_epi32(0x43, 0x00, 0x00, (int)0x80000000);
+
+    __m128i carry;
+    __m128i lsb;
+
+    in    = _mm_shuffle_epi8(in, reverse);
+    lsb   = _mm_shuffle_epi32(_mm_srai_epi32(_mm_slli_epi32(in, 31), 31), 0x00);
+    carry = _mm_srli_si128(_mm_slli_epi64(in, 63), 8);
+
+    in = _mm_or_si128(_mm_srli_epi64(in, 1), carry);
+    in = _mm_xor_si128(in, _mm_and_si128(lsb, polynomial));
+
+    return _mm_shuffle_epi8(in, reverse);
+}
+
+
+/**
+ * @brief Number of trailing zero bits of a non-zero block index
+ */
+BCMLIB_FORCEINLINE unsigned long pmacp_ntz(unsigned long index)
+{
+    unsigned long bits = 0;
+
+    while (!(index & 1))
+    {
+        index >>= 1;
+        ++bits;
+    }
+
+    return bits;
+}
+
+
+/**
+ * @brief Computes offsets required to process `blocks` blocks
+ */
+BCMLIB_FORCEINLINE void pmacp_offsets_init(unsigned long blocks, const KEY* key, PMACP_OFFSETS* offsets,
+                                           const BLOCK_CIPHER* cipher)
+{
+    unsigned long level;
+
+    //
+    // L = Encrypt(K, 0...0)
+    //
+
+    cipher->encrypt_block(_mm_setzero_si128(), key, &offsets->L[0]);
+
+    offsets->L_inverse = pmacp_half(offsets->L[0]);
+
+    //
+    // Offset levels up to the number of significant bits in block count
+    //
+
+    for (level = 1, blocks >>= 1; blocks && level < PMACP_MAX_LEVELS; ++level, blocks >>= 1)
+    {
+        offsets->L[level] = pmacp_double(offsets->L[level - 1]);
+    }
+}
+
+
+/**
+ * @brief Offset of block with a given (1-based) index. Sequentially offsets
+ *        are computed as Offset(i) = Offset(i - 1) + L(ntz(i)), that gives
+ *        Offset(i) = sum of L(k) over bits k set in Gray code of i.
+ *        So each block's offset is computed independently.
+ */
+BCMLIB_FORCEINLINE __m128i pmacp_offset(unsigned long index, const PMACP_OFFSETS* offsets)
+{
+    unsigned long gray = index ^ (index >> 1);
+    unsigned long level;
+
+    __m128i offset = _mm_setzero_si128();
+
+    for (level = 0; gray; ++level, gray >>= 1)
+    {
+        if (gray & 1)
+        {
+            offset = _mm_xor_si128(offset, offsets->L[level]);
+        }
+    }
+
+    return offset;
+}
+
+
+/**
+ * @brief Computes sum of Encrypt(M[i] + Offset(i)) over `blocks` blocks
+ *        starting from block with (1-based) index `first_index`.
+ */
+BCMLIB_FORCEINLINE __m128i pmacp_sum(const unsigned char* in, unsigned long first_index, unsigned long blocks,
+                                     const PMACP_OFFSETS* offsets, const KEY* key, const BLOCK_CIPHER* cipher)
+{
+    unsigned long block;
+    unsigned long window;
+    unsigned long idx;
+    unsigned long index = first_index;
+
+    const __m128i* internal_in = (const __m128i*)in;
+
+    __m128i offset = pmacp_offset(first_index - 1, offsets);
+    __m128i sum    = _mm_setzero_si128();
+    __m128i temporary[PMACP_PARALLEL_BLOCKS];
+
+    for (block = 0; block < blocks; block += window)
+    {
+        window = blocks - block;
+
+        if (window > PMACP_PARALLEL_BLOCKS)
+        {
+            window = PMACP_PARALLEL_BLOCKS;
+        }
+
+        //
+        // Offsets do not depend on cipher output, so a whole
+        // window of blocks is passed to the cipher at once
+        //
+
+        for (idx = 0; idx < window; ++idx, ++index)
+        {
+            offset         = _mm_xor_si128(offset, offsets->L[pmacp_ntz(index)]);
+            temporary[idx] = _mm_xor_si128(_mm_loadu_si128(internal_in + block + idx), offset);
+        }
+
+        for (idx = 0; idx < window; ++idx)
+        {
+            cipher->encrypt_block(temporary[idx], key, &temporary[idx]);
+        }
+
+        for (idx = 0; idx < window; ++idx)
+        {
+            sum = _mm_xor_si128(sum, temporary[idx]);
+        }
+    }
+
+    return sum;
+}
+
+
+/**
+ * @brief Finishes PMAC: adds the last block and encrypts the sum
+ */
+BCMLIB_FORCEINLINE void pmacp_finalize(__m128i sum, const unsigned char* last, const PMACP_OFFSETS* offsets,
+                                       const KEY* key, unsigned long significant_bits, unsigned char* out,
+                                       const BLOCK_CIPHER* cipher)
+{
+    //
+    // Here we assume full disk encryption setting, so the last
+    // block is complete and it is masked by L * x^(-1)
+    //
+
+    sum = _mm_xor_si128(sum, _mm_loadu_si128((const __m128i*)last));
+    sum = _mm_xor_si128(sum, offsets->L_inverse);
+    cipher->encrypt_block(sum, key, &sum);
+
+    _mm_storeu_si128((__m128i*)out, _mm_and_si128(sum, pmacp_mask(significant_bits)));
+}
+
+
+/**
+ * @brief Compares a computed tag with a given one.
+ */
+BCMLIB_FORCEINLINE pmac_verify_result pmacp_compare(__m128i new_tag, const unsigned char* tag)
+{
+    __m128i difference = _mm_xor_si128(new_tag, _mm_loadu_si128((const __m128i*)tag));
+
+    return _mm_test_all_zeros(difference, difference)
+             ? pmac_valid
+             : pmac_invalid;
+}
+
+
+/**
+ * @brief Computes partial sum of a single chunk (executor's task routine).
+ */
+static void pmacp_sum_chunk(void* context, unsigned long task)
+{
+    const PMACP_PARALLEL_CONTEXT* internal_context = (const PMACP_PARALLEL_CONTEXT*)context;
+
+    unsigned long first_block = task * internal_context->chunk_blocks;
+    unsigned long offset      = first_block * internal_context->cipher->block_size;
+    unsigned long blocks      = internal_context->blocks - first_block;
+
+    if (blocks > internal_context->chunk_blocks)
+    {
+        blocks = internal_context->chunk_blocks;
+    }
+
+    internal_context->sums[task] = pmacp_sum(internal_context->in + offset, first_block + 1, blocks,
+                                             internal_context->offsets, internal_context->key,
+                                             internal_context->cipher);
+}
+
+
+void pmac_digest(const unsigned char* in, unsigned long blocks,
+                 const unsigned char* key, unsigned long significant_bits,
+                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
+
+    pmac_digest_perform(in, blocks, &internal_key, significant_bits, out, cipher);
+}
+
+
+void pmac_digest_perform(const unsigned char* in, unsigned long blocks,
+                         const KEY* key, unsigned long significant_bits,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    PMACP_OFFSETS offsets;
+    __m128i sum;
+
+    pmacp_offsets_init(blocks, key, &offsets, cipher);
+
+    sum = pmacp_sum(in, 1, blocks - 1, &offsets, key, cipher);
+
+    pmacp_finalize(sum, in + (blocks - 1) * cipher->block_size, &offsets, key, significant_bits, out, cipher);
+}
+
+
+pmac_verify_result pmac_verify(const unsigned char* in, unsigned long blocks,
+                               const unsigned char* key, const unsigned char* tag,
+                               unsigned long significant_bits, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
+
+    return pmac_verify_perform(in, blocks, &internal_key, tag, significant_bits, cipher);
+}
+
+
+pmac_verify_result pmac_verify_perform(const unsigned char* in, unsigned long blocks,
+                                       const KEY* key, const unsigned char* tag,
+                                       unsigned long significant_bits, const BLOCK_CIPHER* cipher)
+{
+    __m128i new_tag;
+
+    pmac_digest_perform(in, blocks, key, significant_bits, (unsigned char*)&new_tag, cipher);
+
+    return pmacp_compare(new_tag, tag);
+}
+
+
+void pmac_digest_parallel(const unsigned char* in, unsigned long blocks,
+                          const unsigned char* key, unsigned long significant_bits, unsigned char* out,
+                          unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
+
+    pmac_digest_parallel_perform(in, blocks, &internal_key, significant_bits, out,
+                                 min_chunk_blocks, executor, cipher);
+}
+
+
+void pmac_digest_parallel_perform(const unsigned char* in, unsigned long blocks,
+                                  const KEY* key, unsigned long significant_bits, unsigned char* out,
+                                  unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher)
+{
+    unsigned long tasks;
+    unsigned long task;
+
+    PMACP_OFFSETS offsets;
+    PMACP_PARALLEL_CONTEXT context;
+
+    __m128i sums[PMACP_MAX_TASKS];
+    __m128i sum = _mm_setzero_si128();
+
+    //
+    // Number of tasks is limited by executor's concurrency,
+    // by minimal chunk size and by storage for partial sums
+    //
+
+    tasks = (blocks - 1) / (min_chunk_blocks ? min_chunk_blocks : 1);
+
+    if (executor && tasks > executor->concurrency)
+    {
+        tasks = executor->concurrency;
+    }
+
+    if (tasks > PMACP_MAX_TASKS)
+    {
+        tasks = PMACP_MAX_TASKS;
+    }
+
+    if (!executor || tasks < 2)
+    {
+        pmac_digest_perform(in, blocks, key, significant_bits, out, cipher);
+        return;
+    }
+
+    pmacp_offsets_init(blocks, key, &offsets, cipher);
+
+    context.in      = in;
+    context.blocks  = blocks - 1;
+    context.offsets = &offsets;
+    context.key     = key;
+    context.sums    = sums;
+    context.cipher  = cipher;
+
+    context.chunk_blocks = (context.blocks + tasks - 1) / tasks;
+    tasks                = (context.blocks + context.chunk_blocks - 1) / context.chunk_blocks;
+
+    executor->run(executor->user_context, pmacp_sum_chunk, &context, tasks);
+
+    //
+    // Sum is just XOR of encrypted blocks, so partial
+    // sums are combined in any order
+    //
+
+    for (task = 0; task < tasks; ++task)
+    {
+        sum = _mm_xor_si128(sum, sums[task]);
+    }
+
+    pmacp_finalize(sum, in + context.blocks * cipher->block_size, &offsets, key, significant_bits, out, cipher);
+}
@@ -5,80 +5,688 @@
 
 #include "modes/xts/xts.h"
 #include "common/utils.h"
+#include "common/executor.h"
+#include "common/cpu.h"
 #include "bclib.h"
 #include "galoislib.h"
 
 #include <immintrin.h>
 
 
+/**
+ * @brief Number of blocks processed simultaneously by XTS kernel.
+ * 
+ * Tweaks for the whole window are computed before any block is
+ * encrypted, so cipher calls inside a window do not depend on
+ * each other and can overlap in CPU pipeline.
+ */
+#define XTSP_PARALLEL_BLOCKS 8
+
+/**
+ * @brief Wide paths keep tweaks of a whole window in AVX-512 or AVX2 registers.
+ */
+BCMLIB_STATIC_ASSERT(XTSP_PARALLEL_BLOCKS == 8, window_is_two_avx512_registers);
+
+
+/**
+ * @brief Direction of XTS transformation.
+ */
+typedef enum tagXTSP_DIRECTION
+{
+    xtsp_encrypt, /**< Use `encrypt_block` of cipher */
+    xtsp_decrypt, /**< Use `decrypt_block` of cipher */
+} XTSP_DIRECTION;
+
+
+/**
+ * @brief Context shared by all tasks of parallel XTS processing.
+ */
+typedef struct tagXTSP_PARALLEL_CONTEXT
+{
+    __m128i tweak; /**< Tweak of the first block of data unit */
+
+    const unsigned char* in; /**< Input data unit */
+
+    unsigned char* out; /**< Output data unit */
+
+    unsigned long blocks; /**< Number of blocks in data unit */
+
+    unsigned long chunk_blocks; /**< Number of blocks processed by a single task */
+
+    const KEY* data_key; /**< Key used to process data */
+
+    XTSP_DIRECTION direction; /**< Direction of transformation */
+
+    const BLOCK_CIPHER* cipher; /**< Block cipher instance */
+} XTSP_PARALLEL_CONTEXT;
+
+
+/**
+ * @brief Creates a block with sector number, that is encrypted to obtain XTS tweak.
+ */
+BCMLIB_FORCEINLINE __m128i xtsp_tweak_block(unsigned long long sector)
+{
+    //
+    // Sector number is stored in little-endian order
+    // and padded with zeros up to a block size
+    //
+
+    return _mm_set_epi64x(0, (long long)sector);
+}
+
+
 /**
  * @brief Initialize XTS tweak.
  */
 BCMLIB_FORCEINLINE __m128i xtsp_tweak_init(unsigned long long sector, const KEY* tweak_key, const BLOCK_CIPHER* cipher)
 {
     __m128i tweak;
-    unsigned int idx;
-    BCMLIB_ALIGN16 unsigned char internal_tweak[MAX_BLOCK_SIZE];
 
-    for (idx = 0; idx < sizeof(internal_tweak); ++idx)
+    tweak = xtsp_tweak_block(sector);
+    cipher->encrypt_block(tweak, tweak_key, &tweak);
+
+    return tweak;
+}
+
+
+/**
+ * @brief Initialize XTS tweaks for `sectors` consecutive sectors at once.
+ */
+BCMLIB_FORCEINLINE void xtsp_tweaks_init(unsigned long long first_sector, unsigned long sectors, const KEY* tweak_key,
+                                         __m128i* tweaks, const BLOCK_CIPHER* cipher)
+{
+    unsigned long sector;
+
+    for (sector = 0; sector < sectors; ++sector)
     {
-        internal_tweak[idx] = (unsigned char)(sector & 0xFF);
-        sector >>= 8;
+        tweaks[sector] = xtsp_tweak_block(first_sector + sector);
     }
 
-    tweak = _mm_load_si128((const __m128i*)internal_tweak);
-    cipher->encrypt_block(tweak, tweak_key, &tweak);
+    //
+    // Tweaks are independent, hence they are encrypted
+    // as a batch without waiting for each other
+    //
+
+    for (sector = 0; sector < sectors; ++sector)
+    {
+        cipher->encrypt_block(tweaks[sector], tweak_key, &tweaks[sector]);
+    }
+}
+
+
+/**
+ * @brief Calculates alpha^power in GF(2^128).
+ */
+BCMLIB_FORCEINLINE __m128i xtsp_alpha_power(unsigned long long power)
+{
+    __m128i result;
+    __m128i base;
+
+    unsigned long long low_power = power & 127;
+
+    //
+    // alpha^n for n < 128 is a monomial, i.e. just a single bit
+    //
+
+    result = (low_power < 64)
+               ? _mm_set_epi64x(0, (long long)(1ull << low_power))
+               : _mm_set_epi64x((long long)(1ull << (low_power - 64)), 0);
+
+    //
+    // Higher powers are obtained via square-and-multiply
+    // with alpha^128 as a base
+    //
+
+    base  = gf128_multiply_primitive(_mm_set_epi64x((long long)(1ull << 63), 0));
+    power = power >> 7;
+
+    while (power)
+    {
+        if (power & 1)
+        {
+            result = gf128_multiply(result, base);
+        }
+
+        base = gf128_multiply(base, base);
+        power >>= 1;
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief Initialize XTS tweak for a block with index `first_block` in a sector.
+ */
+BCMLIB_FORCEINLINE __m128i xtsp_tweak_init_at(unsigned long long sector, unsigned long first_block,
+                                              const KEY* tweak_key, const BLOCK_CIPHER* cipher)
+{
+    __m128i tweak = xtsp_tweak_init(sector, tweak_key, cipher);
+
+    //
+    // Jump directly to tweak * alpha^first_block instead
+    // of multiplying tweak by alpha block by block
+    //
+
+    return first_block
+             ? gf128_multiply(tweak, xtsp_alpha_power(first_block))
+             : tweak;
+}
+
+
+/**
+ * @brief Processes up to `XTSP_PARALLEL_BLOCKS` blocks with consecutive tweaks.
+ * 
+ * @return tweak for a block next to the last processed one
+ */
+BCMLIB_FORCEINLINE __m128i xtsp_process_window(const __m128i* in, unsigned long blocks, __m128i tweak, const KEY* data_key,
+                                               __m128i* out, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long block;
+
+    __m128i tweaks[XTSP_PARALLEL_BLOCKS];
+    __m128i temporary[XTSP_PARALLEL_BLOCKS];
+
+    //
+    // Tweak chain does not depend on data, so compute
+    // it for the whole window at once
+    //
+
+    for (block = 0; block < blocks; ++block)
+    {
+        tweaks[block] = tweak;
+        tweak         = gf128_multiply_primitive(tweak);
+    }
+
+    for (block = 0; block < blocks; ++block)
+    {
+        temporary[block] = _mm_xor_si128(_mm_loadu_si128(&in[block]), tweaks[block]);
+    }
+
+    //
+    // Now blocks are independent: the cipher is able
+    // to process them without waiting for each other
+    //
+
+    if (direction == xtsp_encrypt)
+    {
+        for (block = 0; block < blocks; ++block)
+        {
+            cipher->encrypt_block(temporary[block], data_key, &temporary[block]);
+        }
+    }
+    else
+    {
+        for (block = 0; block < blocks; ++block)
+        {
+            cipher->decrypt_block(temporary[block], data_key, &temporary[block]);
+        }
+    }
+
+    for (block = 0; block < blocks; ++block)
+    {
+        _mm_storeu_si128(&out[block], _mm_xor_si128(temporary[block], tweaks[block]));
+    }
 
     return tweak;
 }
 
 
-void xts_encrypt(unsigned long long sector, const unsigned char* in, unsigned long blocks,
-                 const unsigned char* data_key, const unsigned char* tweak_key,
-                 unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Multiplies each 128-bit lane by alpha^4 (AVX-512 version).
+ */
+BCMLIB_FORCEINLINE BCMLIB_TARGET_AVX512_VPCLMULQDQ __m512i xtsp_avx512_multiply_alpha4(__m512i tweaks)
 {
-    KEY internal_data_key;
-    KEY internal_tweak_key;
+    //
+    // Shift each lane left by 4 bits: bits shifted out of the low half go
+    // to the high half, bits shifted out of the high half are reduced
+    // modulo x^128 + x^7 + x^2 + x + 1 via carry-less multiplication
+    //
 
-    cipher->initialize_encrypt_key(data_key, &internal_data_key);
-    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+    const __m512i polynomial = _mm512_set1_epi64(0x87);
 
-    xts_encrypt_perform(sector, in, blocks, &internal_data_key,
-                        &internal_tweak_key, out, cipher);
+    __m512i carry   = _mm512_srli_epi64(tweaks, 60);
+    __m512i swapped = _mm512_shuffle_epi32(carry, _MM_PERM_BADC);
+
+    tweaks = _mm512_slli_epi64(tweaks, 4);
+    tweaks = _mm512_xor_si512(tweaks, _mm512_maskz_mov_epi64(0xAA, swapped));
+    tweaks = _mm512_xor_si512(tweaks, _mm512_clmulepi64_epi128(swapped, polynomial, 0x00));
+
+    return tweaks;
 }
 
 
-void xts_encrypt_perform(unsigned long long sector, const unsigned char* in, unsigned long blocks,
-                         const KEY* data_key, const KEY* tweak_key,
-                         unsigned char* out, const BLOCK_CIPHER* cipher)
+/**
+ * @brief Multiplies each 128-bit lane by alpha^2 (AVX2 version).
+ */
+BCMLIB_FORCEINLINE BCMLIB_TARGET_AVX2_VPCLMULQDQ __m256i xtsp_avx2_multiply_alpha2(__m256i tweaks)
 {
-    unsigned int block;
+    //
+    // The same as `xtsp_avx512_multiply_alpha4`, but
+    // with two lanes and shift by 2 bits
+    //
 
-    __m128i temporary;
-    __m128i tweak;
+    const __m256i polynomial = _mm256_set1_epi64x(0x87);
 
-    tweak = xtsp_tweak_init(sector, tweak_key, cipher);
+    __m256i carry   = _mm256_srli_epi64(tweaks, 62);
+    __m256i swapped = _mm256_shuffle_epi32(carry, 0x4E);
+
+    tweaks = _mm256_slli_epi64(tweaks, 2);
+    tweaks = _mm256_xor_si256(tweaks, _mm256_blend_epi32(_mm256_setzero_si256(), swapped, 0xCC));
+    tweaks = _mm256_xor_si256(tweaks, _mm256_clmulepi64_epi128(swapped, polynomial, 0x00));
+
+    return tweaks;
+}
 
-    for (block = 0; block < blocks; ++block, in += cipher->block_size, out += cipher->block_size)
+
+/**
+ * @brief Calls cipher for each block of a window.
+ */
+BCMLIB_FORCEINLINE void xtsp_crypt_window(__m128i* blocks, const KEY* data_key, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long block;
+
+    if (direction == xtsp_encrypt)
     {
-        //
-        // Encrypt block
-        //
+        for (block = 0; block < XTSP_PARALLEL_BLOCKS; ++block)
+        {
+            cipher->encrypt_block(blocks[block], data_key, &blocks[block]);
+        }
+    }
+    else
+    {
+        for (block = 0; block < XTSP_PARALLEL_BLOCKS; ++block)
+        {
+            cipher->decrypt_block(blocks[block], data_key, &blocks[block]);
+        }
+    }
+}
 
-        temporary = _mm_loadu_si128((const __m128i*)in);
 
-        temporary = _mm_xor_si128(temporary, tweak);
-        cipher->encrypt_block(temporary, data_key, &temporary);
-        temporary = _mm_xor_si128(temporary, tweak);
+/**
+ * @brief Processes full windows of a data unit using AVX-512 (4 tweaks per register).
+ * 
+ * @return tweak for a block next to the last processed one
+ */
+BCMLIB_TARGET_AVX512_VPCLMULQDQ __m128i xtsp_avx512_process(__m128i tweak, const __m128i* in, unsigned long windows, const KEY* data_key,
+                                                            __m128i* out, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    BCMLIB_ALIGN16 __m128i tweaks[4];
+    BCMLIB_ALIGN16 __m128i temporary[XTSP_PARALLEL_BLOCKS];
+
+    __m512i low_tweaks;
+    __m512i high_tweaks;
 
-        _mm_storeu_si128((__m128i*)out, temporary);
+    tweaks[0] = tweak;
+    tweaks[1] = gf128_multiply_primitive(tweaks[0]);
+    tweaks[2] = gf128_multiply_primitive(tweaks[1]);
+    tweaks[3] = gf128_multiply_primitive(tweaks[2]);
+
+    low_tweaks = _mm512_loadu_si512(tweaks);
+
+    for (; windows; --windows, in += XTSP_PARALLEL_BLOCKS, out += XTSP_PARALLEL_BLOCKS)
+    {
+        high_tweaks = xtsp_avx512_multiply_alpha4(low_tweaks);
+
+        _mm512_storeu_si512(&temporary[0], _mm512_xor_si512(_mm512_loadu_si512(&in[0]), low_tweaks));
+        _mm512_storeu_si512(&temporary[4], _mm512_xor_si512(_mm512_loadu_si512(&in[4]), high_tweaks));
 
         //
-        // Multiply tweak by x (alpha)
+        // Cipher is a legacy SSE code, so clear upper
+        // halves of registers to avoid transition penalty
         //
 
-        tweak = gf128_multiply_primitive(tweak);
+        _mm256_zeroupper();
+        xtsp_crypt_window(temporary, data_key, direction, cipher);
+
+        _mm512_storeu_si512(&out[0], _mm512_xor_si512(_mm512_loadu_si512(&temporary[0]), low_tweaks));
+        _mm512_storeu_si512(&out[4], _mm512_xor_si512(_mm512_loadu_si512(&temporary[4]), high_tweaks));
+
+        low_tweaks = xtsp_avx512_multiply_alpha4(high_tweaks);
+    }
+
+    tweak = _mm512_castsi512_si128(low_tweaks);
+    _mm256_zeroupper();
+
+    return tweak;
+}
+
+
+/**
+ * @brief Processes full windows of a data unit using AVX2 (2 tweaks per register).
+ * 
+ * @return tweak for a block next to the last processed one
+ */
+BCMLIB_TARGET_AVX2_VPCLMULQDQ __m128i xtsp_avx2_process(__m128i tweak, const __m128i* in, unsigned long windows, const KEY* data_key,
+                                                        __m128i* out, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long idx;
+
+    BCMLIB_ALIGN16 __m128i tweaks[2];
+    BCMLIB_ALIGN16 __m128i temporary[XTSP_PARALLEL_BLOCKS];
+
+    __m256i window_tweaks[XTSP_PARALLEL_BLOCKS / 2];
+
+    tweaks[0] = tweak;
+    tweaks[1] = gf128_multiply_primitive(tweaks[0]);
+
+    window_tweaks[0] = _mm256_loadu_si256((const __m256i*)tweaks);
+
+    for (; windows; --windows, in += XTSP_PARALLEL_BLOCKS, out += XTSP_PARALLEL_BLOCKS)
+    {
+        for (idx = 1; idx < XTSP_PARALLEL_BLOCKS / 2; ++idx)
+        {
+            window_tweaks[idx] = xtsp_avx2_multiply_alpha2(window_tweaks[idx - 1]);
+        }
+
+        for (idx = 0; idx < XTSP_PARALLEL_BLOCKS / 2; ++idx)
+        {
+            _mm256_storeu_si256((__m256i*)&temporary[2 * idx],
+                                _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&in[2 * idx]), window_tweaks[idx]));
+        }
+
+        _mm256_zeroupper();
+        xtsp_crypt_window(temporary, data_key, direction, cipher);
+
+        for (idx = 0; idx < XTSP_PARALLEL_BLOCKS / 2; ++idx)
+        {
+            _mm256_storeu_si256((__m256i*)&out[2 * idx],
+                                _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&temporary[2 * idx]), window_tweaks[idx]));
+        }
+
+        window_tweaks[0] = xtsp_avx2_multiply_alpha2(window_tweaks[XTSP_PARALLEL_BLOCKS / 2 - 1]);
+    }
+
+    tweak = _mm256_castsi256_si128(window_tweaks[0]);
+    _mm256_zeroupper();
+
+    return tweak;
+}
+
+
+/**
+ * @brief XTS kernel: processes a data unit window by window.
+ * 
+ * Full windows are processed by the widest vector extension available
+ * at runtime, SSE path is used as a fallback and for the last window.
+ * 
+ * @return tweak for a block next to the last processed one
+ */
+BCMLIB_FORCEINLINE __m128i xtsp_process(__m128i tweak, const unsigned char* in, unsigned long blocks, const KEY* data_key,
+                                     unsigned char* out, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long window;
+    unsigned long features;
+
+    const __m128i* internal_in = (const __m128i*)in;
+    __m128i* internal_out      = (__m128i*)out;
+
+    window = blocks / XTSP_PARALLEL_BLOCKS;
+
+    if (window)
+    {
+        features = bcmlib_cpu_features();
+
+        if (features & BCMLIB_CPU_AVX512_VPCLMULQDQ)
+        {
+            tweak = xtsp_avx512_process(tweak, internal_in, window, data_key, internal_out, direction, cipher);
+        }
+        else if (features & BCMLIB_CPU_AVX2_VPCLMULQDQ)
+        {
+            tweak = xtsp_avx2_process(tweak, internal_in, window, data_key, internal_out, direction, cipher);
+        }
+        else
+        {
+            window = 0;
+        }
+
+        internal_in += window * XTSP_PARALLEL_BLOCKS;
+        internal_out += window * XTSP_PARALLEL_BLOCKS;
+        blocks -= window * XTSP_PARALLEL_BLOCKS;
+    }
+
+    while (blocks)
+    {
+        window = (blocks < XTSP_PARALLEL_BLOCKS) ? blocks : XTSP_PARALLEL_BLOCKS;
+        tweak  = xtsp_process_window(internal_in, window, tweak, data_key, internal_out, direction, cipher);
+
+        internal_in += window;
+        internal_out += window;
+        blocks -= window;
+    }
+
+    return tweak;
+}
+
+
+/**
+ * @brief Processes a single block with a given tweak.
+ */
+BCMLIB_FORCEINLINE __m128i xtsp_process_block(__m128i block, __m128i tweak, const KEY* data_key,
+                                              XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    block = _mm_xor_si128(block, tweak);
+
+    if (direction == xtsp_encrypt)
+    {
+        cipher->encrypt_block(block, data_key, &block);
+    }
+    else
+    {
+        cipher->decrypt_block(block, data_key, &block);
+    }
+
+    return _mm_xor_si128(block, tweak);
+}
+
+
+/**
+ * @brief XTS kernel for data units with incomplete last block (ciphertext stealing).
+ */
+BCMLIB_FORCEINLINE void xtsp_process_bytes(__m128i tweak, const unsigned char* in, unsigned long size, const KEY* data_key,
+                                           unsigned char* out, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long idx;
+    unsigned char temporary;
+    unsigned char* tail;
+
+    unsigned long blocks    = size / cipher->block_size;
+    unsigned long remainder = size % cipher->block_size;
+    unsigned long offset    = (blocks - 1) * cipher->block_size;
+
+    __m128i block;
+    __m128i last_tweak;
+    __m128i next_tweak;
+
+    BCMLIB_ALIGN16 unsigned char stolen[MAX_BLOCK_SIZE];
+
+    if (!remainder)
+    {
+        xtsp_process(tweak, in, blocks, data_key, out, direction, cipher);
+        return;
+    }
+
+    //
+    // All complete blocks except the last one are processed as usual
+    //
+
+    last_tweak = xtsp_process(tweak, in, blocks - 1, data_key, out, direction, cipher);
+    next_tweak = gf128_multiply_primitive(last_tweak);
+
+    //
+    // IEEE 1619, 5.3.2 and 5.4.2:
+    //   encryption: CC = Enc(P[m - 1], T[m - 1]), C[m] = CC[0..r), PP = P[m] || CC[r..)
+    //               C[m - 1] = Enc(PP, T[m])
+    //   decryption: PP = Dec(C[m - 1], T[m]), P[m] = PP[0..r), CC = C[m] || PP[r..)
+    //               P[m - 1] = Dec(CC, T[m - 1])
+    // 
+    // Note, that tweaks are swapped for decryption
+    //
+
+    if (direction == xtsp_decrypt)
+    {
+        block      = last_tweak;
+        last_tweak = next_tweak;
+        next_tweak = block;
+    }
+
+    block = _mm_loadu_si128((const __m128i*)(in + offset));
+    block = xtsp_process_block(block, last_tweak, data_key, direction, cipher);
+
+    _mm_store_si128((__m128i*)stolen, block);
+
+    //
+    // Steal the head of processed block for the incomplete one and fill
+    // the head with the incomplete block's data. Each byte is read before
+    // it is written, so data can be processed in place.
+    //
+
+    in += offset + cipher->block_size;
+    tail = out + offset + cipher->block_size;
+
+    for (idx = 0; idx < remainder; ++idx)
+    {
+        temporary   = in[idx];
+        tail[idx]   = stolen[idx];
+        stolen[idx] = temporary;
+    }
+
+    block = _mm_load_si128((const __m128i*)stolen);
+    block = xtsp_process_block(block, next_tweak, data_key, direction, cipher);
+
+    _mm_storeu_si128((__m128i*)(out + offset), block);
+}
+
+
+/**
+ * @brief XTS kernel for several consecutive sectors.
+ */
+BCMLIB_FORCEINLINE void xtsp_process_sectors(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                                             unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                             unsigned char* out, XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long sector;
+    unsigned long batch;
+
+    __m128i tweaks[XTSP_PARALLEL_BLOCKS];
+
+    const unsigned long sector_size = blocks * cipher->block_size;
+
+    while (sectors)
+    {
+        batch = (sectors < XTSP_PARALLEL_BLOCKS) ? sectors : XTSP_PARALLEL_BLOCKS;
+
+        xtsp_tweaks_init(first_sector, batch, tweak_key, tweaks, cipher);
+
+        for (sector = 0; sector < batch; ++sector, in += sector_size, out += sector_size)
+        {
+            xtsp_process(tweaks[sector], in, blocks, data_key, out, direction, cipher);
+        }
+
+        first_sector += batch;
+        sectors -= batch;
+    }
+}
+
+
+/**
+ * @brief Processes a single chunk of data unit (executor's task routine).
+ */
+static void xtsp_process_chunk(void* context, unsigned long task)
+{
+    const XTSP_PARALLEL_CONTEXT* internal_context = (const XTSP_PARALLEL_CONTEXT*)context;
+
+    unsigned long first_block = task * internal_context->chunk_blocks;
+    unsigned long offset      = first_block * internal_context->cipher->block_size;
+    unsigned long blocks      = internal_context->blocks - first_block;
+
+    __m128i tweak;
+
+    if (blocks > internal_context->chunk_blocks)
+    {
+        blocks = internal_context->chunk_blocks;
+    }
+
+    //
+    // Each chunk seeds its own tweak, so chunks
+    // are processed independently
+    //
+
+    tweak = first_block
+              ? gf128_multiply(internal_context->tweak, xtsp_alpha_power(first_block))
+              : internal_context->tweak;
+
+    xtsp_process(tweak, internal_context->in + offset, blocks, internal_context->data_key,
+                 internal_context->out + offset, internal_context->direction, internal_context->cipher);
+}
+
+
+/**
+ * @brief XTS kernel, that splits a data unit into chunks processed by executor.
+ */
+BCMLIB_FORCEINLINE void xtsp_process_parallel(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                                              const KEY* data_key, const KEY* tweak_key, unsigned char* out,
+                                              unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor,
+                                              XTSP_DIRECTION direction, const BLOCK_CIPHER* cipher)
+{
+    unsigned long tasks;
+
+    XTSP_PARALLEL_CONTEXT context;
+
+    context.tweak     = xtsp_tweak_init(sector, tweak_key, cipher);
+    context.in        = in;
+    context.out       = out;
+    context.blocks    = blocks;
+    context.data_key  = data_key;
+    context.direction = direction;
+    context.cipher    = cipher;
+
+    //
+    // Number of tasks is limited by executor's concurrency
+    // and by minimal chunk size
+    //
+
+    tasks = blocks / (min_chunk_blocks ? min_chunk_blocks : 1);
+
+    if (executor && tasks > executor->concurrency)
+    {
+        tasks = executor->concurrency;
+    }
+
+    if (!executor || tasks < 2)
+    {
+        xtsp_process(context.tweak, in, blocks, data_key, out, direction, cipher);
+        return;
     }
+
+    context.chunk_blocks = (blocks + tasks - 1) / tasks;
+    tasks                = (blocks + context.chunk_blocks - 1) / context.chunk_blocks;
+
+    executor->run(executor->user_context, xtsp_process_chunk, &context, tasks);
+}
+
+
+void xts_encrypt(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                 const unsigned char* data_key, const unsigned char* tweak_key,
+                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_encrypt_perform(sector, in, blocks, &internal_data_key,
+                        &internal_tweak_key, out, cipher);
+}
+
+
+void xts_encrypt_perform(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                         const KEY* data_key, const KEY* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i tweak = xtsp_tweak_init(sector, tweak_key, cipher);
+    xtsp_process(tweak, in, blocks, data_key, out, xtsp_encrypt, cipher);
 }
 
 
@@ -101,31 +709,232 @@ void xts_decrypt_perform(unsigned long long sector, const unsigned char* in, uns
                          const KEY* data_key, const KEY* tweak_key,
                          unsigned char* out, const BLOCK_CIPHER* cipher)
 {
-    unsigned int block;
+    __m128i tweak = xtsp_tweak_init(sector, tweak_key, cipher);
+    xtsp_process(tweak, in, blocks, data_key, out, xtsp_decrypt, cipher);
+}
+
+
+void xts_encrypt_sectors(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_encrypt_sectors_perform(first_sector, sectors, in, blocks, &internal_data_key,
+                                &internal_tweak_key, out, cipher);
+}
+
+
+void xts_encrypt_sectors_perform(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    xtsp_process_sectors(first_sector, sectors, in, blocks, data_key, tweak_key, out, xtsp_encrypt, cipher);
+}
+
+
+void xts_decrypt_sectors(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                         unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                         unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_decrypt_sectors_perform(first_sector, sectors, in, blocks, &internal_data_key,
+                                &internal_tweak_key, out, cipher);
+}
+
+
+void xts_decrypt_sectors_perform(unsigned long long first_sector, unsigned long sectors, const unsigned char* in,
+                                 unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                 unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    xtsp_process_sectors(first_sector, sectors, in, blocks, data_key, tweak_key, out, xtsp_decrypt, cipher);
+}
+
+
+void xts_encrypt_blocks(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                        unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                        unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_encrypt_blocks_perform(sector, first_block, in, blocks, &internal_data_key,
+                               &internal_tweak_key, out, cipher);
+}
+
+
+void xts_encrypt_blocks_perform(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                                unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i tweak = xtsp_tweak_init_at(sector, first_block, tweak_key, cipher);
+    xtsp_process(tweak, in, blocks, data_key, out, xtsp_encrypt, cipher);
+}
+
+
+void xts_decrypt_blocks(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                        unsigned long blocks, const unsigned char* data_key, const unsigned char* tweak_key,
+                        unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_decrypt_blocks_perform(sector, first_block, in, blocks, &internal_data_key,
+                               &internal_tweak_key, out, cipher);
+}
+
+
+void xts_decrypt_blocks_perform(unsigned long long sector, unsigned long first_block, const unsigned char* in,
+                                unsigned long blocks, const KEY* data_key, const KEY* tweak_key,
+                                unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i tweak = xtsp_tweak_init_at(sector, first_block, tweak_key, cipher);
+    xtsp_process(tweak, in, blocks, data_key, out, xtsp_decrypt, cipher);
+}
+
+
+void xts_encrypt_parallel(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                          const unsigned char* data_key, const unsigned char* tweak_key, unsigned char* out,
+                          unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_encrypt_parallel_perform(sector, in, blocks, &internal_data_key, &internal_tweak_key,
+                                 out, min_chunk_blocks, executor, cipher);
+}
+
+
+void xts_encrypt_parallel_perform(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                                  const KEY* data_key, const KEY* tweak_key, unsigned char* out,
+                                  unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher)
+{
+    xtsp_process_parallel(sector, in, blocks, data_key, tweak_key, out,
+                          min_chunk_blocks, executor, xtsp_encrypt, cipher);
+}
+
+
+void xts_decrypt_parallel(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                          const unsigned char* data_key, const unsigned char* tweak_key, unsigned char* out,
+                          unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    xts_decrypt_parallel_perform(sector, in, blocks, &internal_data_key, &internal_tweak_key,
+                                 out, min_chunk_blocks, executor, cipher);
+}
+
+
+void xts_decrypt_parallel_perform(unsigned long long sector, const unsigned char* in, unsigned long blocks,
+                                  const KEY* data_key, const KEY* tweak_key, unsigned char* out,
+                                  unsigned long min_chunk_blocks, const BCMLIB_EXECUTOR* executor, const BLOCK_CIPHER* cipher)
+{
+    xtsp_process_parallel(sector, in, blocks, data_key, tweak_key, out,
+                          min_chunk_blocks, executor, xtsp_decrypt, cipher);
+}
+
+
+xts_result xts_encrypt_bytes(unsigned long long sector, const unsigned char* in, unsigned long size,
+                             const unsigned char* data_key, const unsigned char* tweak_key,
+                             unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
 
-    __m128i temporary;
+    if (size < cipher->block_size)
+    {
+        return xts_invalid_length;
+    }
+
+    cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    return xts_encrypt_bytes_perform(sector, in, size, &internal_data_key,
+                                     &internal_tweak_key, out, cipher);
+}
+
+
+xts_result xts_encrypt_bytes_perform(unsigned long long sector, const unsigned char* in, unsigned long size,
+                                     const KEY* data_key, const KEY* tweak_key,
+                                     unsigned char* out, const BLOCK_CIPHER* cipher)
+{
     __m128i tweak;
 
+    //
+    // Stealing needs a complete block
+    //
+
+    if (size < cipher->block_size)
+    {
+        return xts_invalid_length;
+    }
+
     tweak = xtsp_tweak_init(sector, tweak_key, cipher);
+    xtsp_process_bytes(tweak, in, size, data_key, out, xtsp_encrypt, cipher);
 
-    for (block = 0; block < blocks; ++block, in += cipher->block_size, out += cipher->block_size)
+    return xts_ok;
+}
+
+
+xts_result xts_decrypt_bytes(unsigned long long sector, const unsigned char* in, unsigned long size,
+                             const unsigned char* data_key, const unsigned char* tweak_key,
+                             unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_data_key;
+    KEY internal_tweak_key;
+
+    if (size < cipher->block_size)
     {
-        //
-        // Encrypt block
-        //
+        return xts_invalid_length;
+    }
 
-        temporary = _mm_loadu_si128((const __m128i*)in);
+    cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
 
-        temporary = _mm_xor_si128(temporary, tweak);
-        cipher->decrypt_block(temporary, data_key, &temporary);
-        temporary = _mm_xor_si128(temporary, tweak);
+    return xts_decrypt_bytes_perform(sector, in, size, &internal_data_key,
+                                     &internal_tweak_key, out, cipher);
+}
 
-        _mm_storeu_si128((__m128i*)out, temporary);
 
-        //
-        // Multiply tweak by x (alpha)
-        //
+xts_result xts_decrypt_bytes_perform(unsigned long long sector, const unsigned char* in, unsigned long size,
+                                     const KEY* data_key, const KEY* tweak_key,
+                                     unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    __m128i tweak;
+
+    //
+    // Stealing needs a complete block
+    //
 
-        tweak = gf128_multiply_primitive(tweak);
+    if (size < cipher->block_size)
+    {
+        return xts_invalid_length;
     }
+
+    tweak = xtsp_tweak_init(sector, tweak_key, cipher);
+    xtsp_process_bytes(tweak, in, size, data_key, out, xtsp_decrypt, cipher);
+
+    return xts_ok;
 }
@@ -30,6 +30,21 @@ BCMLIB_TESTS_ALIGN16 static constexpr unsigned char incorrect_digest[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
+
+/**
+ * @brief Size of data with incomplete last block (all the data, except the last byte).
+ */
+static constexpr unsigned long partial_size = blocks * KUZNYECHIK_BLOCK_SIZE - 1;
+
+
+/**
+ * @brief Digest of the first `partial_size` bytes of data (padded, K2 is used).
+ */
+BCMLIB_TESTS_ALIGN16 static constexpr unsigned char partial_digest[] = {
+    0xbe, 0x13, 0x5f, 0x9a, 0xed, 0xda, 0xab, 0x2b,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
 }  // namespace test::data::mac
 
 
@@ -115,3 +130,186 @@ TEST(CmacKuznyechik, VerifyIncorrect)
 
     EXPECT_EQ(result, cmac_verify_result::cmac_invalid);
 }
+
+
+TEST(CmacKuznyechik, DigestVerifyContext)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Digest MUST match an expected test vector
+    // Verification results MUST match ones of `cmac_verify`
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY key;
+    cipher.initialize_encrypt_key(mac::key, &key);
+
+    CMAC_CONTEXT context;
+    cmac_context_init(&key, &context, &cipher);
+
+    unsigned char digest[] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+
+    cmac_digest_context(mac::data, mac::blocks, &context, mac::significant_bits, digest);
+
+    EXPECT_PRED3(test::details::EqualBlocks, mac::digest, digest,
+                 KUZNYECHIK_BLOCK_SIZE);
+
+    EXPECT_EQ(cmac_verify_context(mac::data, mac::blocks, &context, mac::digest, mac::significant_bits),
+              cmac_verify_result::cmac_valid);
+
+    EXPECT_EQ(cmac_verify_context(mac::data, mac::blocks, &context, mac::incorrect_digest, mac::significant_bits),
+              cmac_verify_result::cmac_invalid);
+}
+
+
+TEST(CmacKuznyechik, DigestVerifyMany)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Each MAC MUST match a MAC computed separately
+    // Each bit of verification bitmap MUST match a result of separate verification
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY key;
+    cipher.initialize_encrypt_key(mac::key, &key);
+
+    CMAC_CONTEXT context;
+    cmac_context_init(&key, &context, &cipher);
+
+    constexpr auto messages       = 19ul;
+    constexpr auto message_blocks = 3ul;
+    constexpr auto message_size   = message_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char data[messages * message_size];
+    BCMLIB_TESTS_ALIGN16 unsigned char tags[messages * KUZNYECHIK_BLOCK_SIZE] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[KUZNYECHIK_BLOCK_SIZE]        = {};
+
+    unsigned char results[(messages + 7) / 8] = {};
+
+    std::iota(std::begin(data), std::end(data), static_cast<unsigned char>(0));
+
+    cmac_digest_many(data, messages, message_blocks, &context, mac::significant_bits, tags);
+
+    for (auto message = 0ul; message < messages; ++message)
+    {
+        cmac_digest_context(data + message * message_size, message_blocks, &context,
+                            mac::significant_bits, expected);
+
+        EXPECT_PRED3(test::details::EqualBlocks, expected, tags + message * KUZNYECHIK_BLOCK_SIZE,
+                     KUZNYECHIK_BLOCK_SIZE);
+    }
+
+    EXPECT_EQ(cmac_verify_many(data, messages, message_blocks, &context, tags, mac::significant_bits, results),
+              cmac_verify_result::cmac_valid);
+
+    EXPECT_TRUE(std::all_of(std::begin(results), std::end(results), [](auto byte) { return byte == 0; }));
+
+    //
+    // Corrupt some tags
+    //
+
+    for (auto message : { 0ul, 7ul, 8ul, 18ul })
+    {
+        tags[message * KUZNYECHIK_BLOCK_SIZE] ^= 0x01;
+    }
+
+    EXPECT_EQ(cmac_verify_many(data, messages, message_blocks, &context, tags, mac::significant_bits, results),
+              cmac_verify_result::cmac_invalid);
+
+    for (auto message = 0ul; message < messages; ++message)
+    {
+        const auto separate = cmac_verify_context(data + message * message_size, message_blocks, &context,
+                                                  tags + message * KUZNYECHIK_BLOCK_SIZE, mac::significant_bits);
+
+        EXPECT_EQ((results[message / 8] >> (message % 8)) & 1, static_cast<int>(separate));
+    }
+}
+
+
+TEST(CmacKuznyechik, Stream)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // MAC of full blocks MUST match an expected test vector for any chunking
+    // MAC of data with incomplete last block MUST match an expected test vector for any chunking
+    // MAC of data with incomplete last block MUST NOT depend on chunking
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY key;
+    cipher.initialize_encrypt_key(mac::key, &key);
+
+    CMAC_CONTEXT context;
+    cmac_context_init(&key, &context, &cipher);
+
+    CMAC_STATE state;
+
+    constexpr auto size = mac::blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    for (auto chunk : { 1ul, 3ul, 15ul, 16ul, 17ul, 33ul, size })
+    {
+        unsigned char digest[KUZNYECHIK_BLOCK_SIZE] = {};
+
+        cmac_init(&context, &state);
+
+        for (auto offset = 0ul; offset < size; offset += chunk)
+        {
+            cmac_update(&state, mac::data + offset, std::min(chunk, size - offset));
+        }
+
+        cmac_final(&state, mac::significant_bits, digest);
+
+        EXPECT_PRED3(test::details::EqualBlocks, mac::digest, digest,
+                     KUZNYECHIK_BLOCK_SIZE);
+
+        cmac_init(&context, &state);
+
+        for (auto offset = 0ul; offset < mac::partial_size; offset += chunk)
+        {
+            cmac_update(&state, mac::data + offset, std::min(chunk, mac::partial_size - offset));
+        }
+
+        cmac_final(&state, mac::significant_bits, digest);
+
+        EXPECT_PRED3(test::details::EqualBlocks, mac::partial_digest, digest,
+                     KUZNYECHIK_BLOCK_SIZE);
+    }
+
+    for (auto partial : { 0ul, 1ul, 15ul, size - 1 })
+    {
+        unsigned char expected[KUZNYECHIK_BLOCK_SIZE] = {};
+        unsigned char digest[KUZNYECHIK_BLOCK_SIZE]   = {};
+
+        cmac_init(&context, &state);
+        cmac_update(&state, mac::data, partial);
+        cmac_final(&state, mac::significant_bits, expected);
+
+        cmac_init(&context, &state);
+
+        for (auto offset = 0ul; offset < partial; ++offset)
+        {
+            cmac_update(&state, mac::data + offset, 1);
+        }
+
+        cmac_final(&state, mac::significant_bits, digest);
+
+        EXPECT_PRED3(test::details::EqualBlocks, expected, digest,
+                     KUZNYECHIK_BLOCK_SIZE);
+    }
+}
@@ -21,6 +21,133 @@ BCMLIB_TESTS_ALIGN16 static constexpr unsigned char ciphertext[] = {
 }  // namespace test::data::enc
 
 
+namespace test::reference {
+
+/**
+ * @brief Straightforward CMC: both CBC passes and masking are separate
+ *        passes over the data unit, doubling is done by `gf128_multiply`.
+ */
+inline void Cmc(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                const unsigned char* data_key, const unsigned char* tweak_key, bool encrypt,
+                unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY internal_tweak_key;
+    KEY internal_data_key;
+
+    cipher->initialize_encrypt_key(tweak_key, &internal_tweak_key);
+
+    if (encrypt)
+    {
+        cipher->initialize_encrypt_key(data_key, &internal_data_key);
+    }
+    else
+    {
+        cipher->initialize_decrypt_key(data_key, &internal_data_key);
+    }
+
+    const auto crypt = [&](__m128i block) {
+        if (encrypt)
+        {
+            cipher->encrypt_block(block, &internal_data_key, &block);
+        }
+        else
+        {
+            cipher->decrypt_block(block, &internal_data_key, &block);
+        }
+
+        return block;
+    };
+
+    __m128i T;
+    cipher->encrypt_block(_mm_set_epi64x(0, static_cast<long long>(tweak)), &internal_tweak_key, &T);
+
+    auto storage = test::details::AlignedStorage(blocks * KUZNYECHIK_BLOCK_SIZE);
+    auto data = reinterpret_cast<__m128i*>(storage.data());
+
+    for (auto block = 0ull; block < blocks; ++block)
+    {
+        data[block] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in) + block);
+    }
+
+    if (encrypt)
+    {
+        //
+        // PPP[i] = E(P[i] + PPP[i - 1]), PPP[0] = T
+        //
+
+        auto previous = T;
+
+        for (auto block = 0ull; block < blocks; ++block)
+        {
+            data[block] = previous = crypt(_mm_xor_si128(data[block], previous));
+        }
+    }
+    else
+    {
+        //
+        // Inverse of the second pass: CCC[i] = D(C[i] + CCC[i + 1]), C[n] is masked by T
+        //
+
+        data[blocks - 1] = _mm_xor_si128(data[blocks - 1], T);
+
+        auto next = _mm_setzero_si128();
+
+        for (auto block = blocks; block-- > 0;)
+        {
+            data[block] = next = crypt(_mm_xor_si128(data[block], next));
+        }
+    }
+
+    //
+    // Masking
+    //
+
+    const auto mask = gf128_multiply(_mm_xor_si128(data[0], data[blocks - 1]), _mm_set_epi64x(0, 2));
+
+    for (auto block = 0ull; block < blocks; ++block)
+    {
+        data[block] = _mm_xor_si128(data[block], mask);
+    }
+
+    if (encrypt)
+    {
+        //
+        // C[i] = E(CCC[i]) + CCC[i + 1], CCC[n + 1] = 0, C[n] is masked by T
+        //
+
+        for (auto block = 0ull; block < blocks; ++block)
+        {
+            const auto next = (block + 1 < blocks) ? data[block + 1] : _mm_setzero_si128();
+            data[block]     = _mm_xor_si128(crypt(data[block]), next);
+        }
+
+        data[blocks - 1] = _mm_xor_si128(data[blocks - 1], T);
+    }
+    else
+    {
+        //
+        // P[i] = D(PPP[i]) + PPP[i - 1], PPP[0] = T
+        //
+
+        auto previous = T;
+
+        for (auto block = 0ull; block < blocks; ++block)
+        {
+            const auto current = data[block];
+            data[block]        = _mm_xor_si128(crypt(current), previous);
+            previous           = current;
+        }
+    }
+
+    for (auto block = 0ull; block < blocks; ++block)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out) + block, data[block]);
+    }
+}
+
+}  // namespace test::reference
+
+
 TEST(CmcKuznyechik, Encrypt)
 {
     using namespace test::data;
@@ -73,3 +200,198 @@ TEST(CmcKuznyechik, Decrypt)
     EXPECT_PRED4(test::details::EqualDataUnits, enc::plaintext,
                  plaintext, enc::blocks, KUZNYECHIK_BLOCK_SIZE);
 }
+
+
+TEST(CmcKuznyechik, EncryptDecrypt)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Decrypted text MUST match an original plaintext (block order included)
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    for (auto blocks : { 1ul, 2ul, 7ul, 8ul, 9ul, 17ul, 32ul })
+    {
+        BCMLIB_TESTS_ALIGN16 unsigned char plaintext[32 * KUZNYECHIK_BLOCK_SIZE];
+        BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[32 * KUZNYECHIK_BLOCK_SIZE] = {};
+        BCMLIB_TESTS_ALIGN16 unsigned char decrypted[32 * KUZNYECHIK_BLOCK_SIZE]  = {};
+
+        std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+        cmc_encrypt(enc::tweak, plaintext, blocks, enc::primary_key,
+                    enc::secondary_key, ciphertext, &cipher);
+
+        cmc_decrypt(enc::tweak, ciphertext, blocks, enc::primary_key,
+                    enc::secondary_key, decrypted, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext,
+                     decrypted, blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        //
+        // In-place decryption
+        //
+
+        cmc_decrypt(enc::tweak, ciphertext, blocks, enc::primary_key,
+                    enc::secondary_key, ciphertext, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext,
+                     ciphertext, blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+TEST(CmcKuznyechik, DecryptBlockOrder)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data units of distinct blocks MUST be encrypted as by a straightforward implementation
+    // Decrypted blocks MUST come in the original order (former cmc_decrypt reversed them)
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    for (auto blocks : { 2ul, 3ul, 9ul, 17ul })
+    {
+        BCMLIB_TESTS_ALIGN16 unsigned char plaintext[17 * KUZNYECHIK_BLOCK_SIZE];
+        BCMLIB_TESTS_ALIGN16 unsigned char expected[17 * KUZNYECHIK_BLOCK_SIZE]  = {};
+        BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[17 * KUZNYECHIK_BLOCK_SIZE] = {};
+        BCMLIB_TESTS_ALIGN16 unsigned char decrypted[17 * KUZNYECHIK_BLOCK_SIZE]  = {};
+
+        //
+        // Each block is filled with its own number
+        //
+
+        for (auto idx = 0ul; idx < sizeof(plaintext); ++idx)
+        {
+            plaintext[idx] = static_cast<unsigned char>(idx / KUZNYECHIK_BLOCK_SIZE);
+        }
+
+        test::reference::Cmc(enc::tweak, plaintext, blocks, enc::primary_key,
+                             enc::secondary_key, true, expected, &cipher);
+
+        cmc_encrypt(enc::tweak, plaintext, blocks, enc::primary_key,
+                    enc::secondary_key, ciphertext, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected,
+                     ciphertext, blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        cmc_decrypt(enc::tweak, expected, blocks, enc::primary_key,
+                    enc::secondary_key, decrypted, &cipher);
+
+        for (auto block = 0ul; block < blocks; ++block)
+        {
+            EXPECT_EQ(decrypted[block * KUZNYECHIK_BLOCK_SIZE], block);
+        }
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext,
+                     decrypted, blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+
+TEST(CmcKuznyechik, EncryptDecryptSectors)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Each encrypted (decrypted) sector MUST match a sector encrypted (decrypted) separately
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto sectors       = 11ul;
+    constexpr auto sector_blocks = 5ul;
+    constexpr auto sector_size   = sector_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sectors * sector_size];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sectors * sector_size] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char decrypted[sectors * sector_size]  = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sector_size]             = {};
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+    cmc_encrypt_sectors(enc::tweak, sectors, plaintext, sector_blocks, enc::primary_key,
+                        enc::secondary_key, ciphertext, &cipher);
+
+    cmc_decrypt_sectors(enc::tweak, sectors, ciphertext, sector_blocks, enc::primary_key,
+                        enc::secondary_key, decrypted, &cipher);
+
+    for (auto sector = 0ul; sector < sectors; ++sector)
+    {
+        cmc_encrypt(enc::tweak + sector, plaintext + sector * sector_size, sector_blocks,
+                    enc::primary_key, enc::secondary_key, expected, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext + sector * sector_size,
+                     sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        cmc_decrypt(enc::tweak + sector, ciphertext + sector * sector_size, sector_blocks,
+                    enc::primary_key, enc::secondary_key, expected, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, decrypted + sector * sector_size,
+                     sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+
+TEST(CmcKuznyechik, EncryptDecryptLarge)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Large data unit MUST be encrypted (decrypted) as by a straightforward implementation
+    // Decrypted large data unit MUST match an original one
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto unit_blocks = 4096ul + 7ul;
+    constexpr auto unit_size   = unit_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    std::vector<unsigned char> plaintext(unit_size);
+    std::vector<unsigned char> expected(unit_size);
+    std::vector<unsigned char> ciphertext(unit_size);
+    std::vector<unsigned char> decrypted(unit_size);
+
+    std::iota(plaintext.begin(), plaintext.end(), static_cast<unsigned char>(0));
+
+    test::reference::Cmc(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key,
+                         enc::secondary_key, true, expected.data(), &cipher);
+
+    cmc_encrypt_large(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key,
+                      enc::secondary_key, ciphertext.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, expected.data(), ciphertext.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    test::reference::Cmc(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key,
+                         enc::secondary_key, false, expected.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), expected.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    cmc_decrypt_large(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key,
+                      enc::secondary_key, decrypted.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), decrypted.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    //
+    // In-place decryption
+    //
+
+    cmc_decrypt_large(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key,
+                      enc::secondary_key, ciphertext.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), ciphertext.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+}
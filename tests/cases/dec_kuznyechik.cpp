@@ -87,3 +87,704 @@ TEST(DecKuznyechik, Decrypt)
     EXPECT_PRED4(test::details::EqualDataUnits, enc::plaintext,
                  plaintext, enc::blocks, KUZNYECHIK_BLOCK_SIZE);
 }
+
+
+TEST(DecKuznyechik, EncryptDecryptContext)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data encrypted with context MUST match data encrypted by `dec_encrypt`
+    // Partition key MUST be derived once per (partition, partition counter)
+    // Data decrypted with context MUST match an original plaintext
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    constexpr auto entries = 8ul;
+    auto storage = test::details::AlignedStorage(dec_key_cache_storage_size(entries));
+
+    DEC_KEY_CACHE partition_keys;
+    dec_key_cache_init(&partition_keys, storage.data(), entries);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+    context.partition_keys = &partition_keys;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sizeof(enc::plaintext)];
+
+    for (unsigned long long partition = 0; partition < 3; ++partition)
+    {
+        for (unsigned long long sector = 0; sector < 4; ++sector)
+        {
+            dec_encrypt(partition, enc::partition_counter, sector, enc::sector_counter,
+                        enc::plaintext, enc::blocks, enc::primary_key, expected, &cipher);
+
+            dec_encrypt_context(partition, enc::partition_counter, sector, enc::sector_counter,
+                                enc::plaintext, enc::blocks, &context, ciphertext);
+
+            EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext,
+                         enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+
+            dec_decrypt_context(partition, enc::partition_counter, sector, enc::sector_counter,
+                                ciphertext, enc::blocks, &context, plaintext);
+
+            EXPECT_PRED4(test::details::EqualDataUnits, enc::plaintext, plaintext,
+                         enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+        }
+    }
+
+    EXPECT_EQ(partition_keys.misses, 3ull);
+    EXPECT_EQ(partition_keys.hits, 21ull);
+
+    //
+    // Cleared cache MUST derive keys again
+    //
+
+    dec_key_cache_clear(&partition_keys);
+
+    dec_encrypt_context(0, enc::partition_counter, 0, enc::sector_counter,
+                        enc::plaintext, enc::blocks, &context, ciphertext);
+
+    EXPECT_EQ(partition_keys.misses, 4ull);
+}
+
+
+TEST(DecKuznyechik, EncryptSectorKeyCache)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data encrypted with cached sector keys MUST match data encrypted by `dec_encrypt`
+    // Rewrites of a sector with the same normalized counter MUST NOT derive any key
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    constexpr auto entries = 16ul;
+    auto partition_storage = test::details::AlignedStorage(dec_key_cache_storage_size(entries));
+    auto sector_storage = test::details::AlignedStorage(dec_key_cache_storage_size(entries));
+
+    DEC_KEY_CACHE partition_keys;
+    DEC_KEY_CACHE sector_keys;
+
+    dec_key_cache_init(&partition_keys, partition_storage.data(), entries);
+    dec_key_cache_init(&sector_keys, sector_storage.data(), entries);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+    context.partition_keys = &partition_keys;
+    context.sector_keys    = &sector_keys;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sizeof(enc::plaintext)];
+
+    for (unsigned long long sector = 0; sector < 2; ++sector)
+    {
+        for (unsigned long long sector_counter = 1; sector_counter <= 4; ++sector_counter)
+        {
+            dec_encrypt(enc::partition, enc::partition_counter, sector, sector_counter,
+                        enc::plaintext, enc::blocks, enc::primary_key, expected, &cipher);
+
+            dec_encrypt_context(enc::partition, enc::partition_counter, sector, sector_counter,
+                                enc::plaintext, enc::blocks, &context, ciphertext);
+
+            EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext,
+                         enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+        }
+    }
+
+    EXPECT_EQ(sector_keys.misses, 2ull);
+    EXPECT_EQ(sector_keys.hits, 6ull);
+    EXPECT_EQ(partition_keys.misses, 1ull);
+    EXPECT_EQ(partition_keys.hits, 1ull);
+}
+
+
+TEST(DecKuznyechik, EncryptSharedKeyCache)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Partition and sector keys MUST NOT collide in a shared cache
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    constexpr auto entries = 16ul;
+    auto storage = test::details::AlignedStorage(dec_key_cache_storage_size(entries));
+
+    DEC_KEY_CACHE keys;
+    dec_key_cache_init(&keys, storage.data(), entries);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+    context.partition_keys = &keys;
+    context.sector_keys    = &keys;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sizeof(enc::plaintext)];
+
+    //
+    // Sector 0 with counter 0 has the same numbers as its partition.
+    // Sector 1 is written first, so partition key is cached before
+    // sector 0 is looked up
+    //
+
+    for (unsigned long long sector : { 1, 0, 0 })
+    {
+        dec_encrypt(enc::partition, enc::partition_counter, sector, 0,
+                    enc::plaintext, enc::blocks, enc::primary_key, expected, &cipher);
+
+        dec_encrypt_context(enc::partition, enc::partition_counter, sector, 0,
+                            enc::plaintext, enc::blocks, &context, ciphertext);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext,
+                     enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+
+    EXPECT_EQ(keys.misses, 3ull);
+    EXPECT_EQ(keys.hits, 2ull);
+}
+
+
+TEST(DecKuznyechik, EncryptDecryptSectors)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Each encrypted (decrypted) sector MUST match a sector encrypted (decrypted) separately
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto sectors       = 11ul;
+    constexpr auto sector_blocks = 13ul;
+    constexpr auto sector_size   = sector_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sectors * sector_size];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sectors * sector_size] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char decrypted[sectors * sector_size]  = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sector_size]             = {};
+
+    unsigned long long sector_counters[sectors];
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+    std::iota(std::begin(sector_counters), std::end(sector_counters), enc::sector_counter);
+
+    dec_encrypt_sectors(enc::partition, enc::partition_counter, enc::sector, sectors, sector_counters,
+                        plaintext, sector_blocks, enc::primary_key, ciphertext, &cipher);
+
+    dec_decrypt_sectors(enc::partition, enc::partition_counter, enc::sector, sectors, sector_counters,
+                        ciphertext, sector_blocks, enc::primary_key, decrypted, &cipher);
+
+    for (auto sector = 0ul; sector < sectors; ++sector)
+    {
+        dec_encrypt(enc::partition, enc::partition_counter, enc::sector + sector, sector_counters[sector],
+                    plaintext + sector * sector_size, sector_blocks, enc::primary_key, expected, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext + sector * sector_size,
+                     sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext + sector * sector_size,
+                     decrypted + sector * sector_size, sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+
+TEST(DecKuznyechik, EncryptPrefetched)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data encrypted with prefetched keystream MUST match data encrypted by `dec_encrypt`
+    // Prefetched keystream MUST be used once
+    // Number of prefetched keystreams MUST be bounded by the budget
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    constexpr auto slots  = 4ul;
+    constexpr auto budget = slots * (enc::blocks * KUZNYECHIK_BLOCK_SIZE + 64);
+    auto storage = test::details::AlignedStorage(budget);
+
+    DEC_KEYSTREAM_CACHE keystreams;
+    dec_keystream_cache_init(&keystreams, storage.data(), budget, enc::blocks);
+
+    EXPECT_GE(keystreams.slots, 1ul);
+    EXPECT_LE(keystreams.slots, slots);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+    context.keystreams = &keystreams;
+
+    std::vector<DEC_KEYSTREAM_REQUEST> requests(keystreams.slots);
+
+    for (auto request = 0ul; request < requests.size(); ++request)
+    {
+        requests[request] = { enc::partition, enc::partition_counter, request, enc::sector_counter + 1 };
+    }
+
+    DEC_PREFETCH_CONTEXT prefetch_context = { &context, requests.data() };
+
+    test::details::ThreadExecutor executor(requests.size());
+    executor.Get()->run(executor.Get()->user_context, dec_keystream_prefetch_routine,
+                        &prefetch_context, requests.size());
+
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sizeof(enc::plaintext)];
+
+    for (const auto& request : requests)
+    {
+        dec_encrypt(request.partition, request.partition_counter, request.sector, request.sector_counter,
+                    enc::plaintext, enc::blocks, enc::primary_key, expected, &cipher);
+
+        dec_encrypt_context(request.partition, request.partition_counter, request.sector, request.sector_counter,
+                            enc::plaintext, enc::blocks, &context, ciphertext);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext,
+                     enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+
+    EXPECT_EQ(keystreams.hits, requests.size());
+    EXPECT_EQ(keystreams.misses, 0ull);
+
+    dec_encrypt(requests[0].partition, requests[0].partition_counter, requests[0].sector,
+                requests[0].sector_counter, enc::plaintext, enc::blocks, enc::primary_key, expected, &cipher);
+
+    dec_encrypt_context(requests[0].partition, requests[0].partition_counter, requests[0].sector,
+                        requests[0].sector_counter, enc::plaintext, enc::blocks, &context, ciphertext);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext,
+                 enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+    EXPECT_EQ(keystreams.misses, 1ull);
+}
+
+
+TEST(DecKuznyechik, EncryptDecryptBlocks)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Encrypted range MUST match the same range of encrypted sector
+    // Decrypted range MUST match the same range of original sector
+    // Range processed with a supplied sector key MUST match as well
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+
+    constexpr auto sector_blocks = 32ul;
+    constexpr auto range_blocks  = 3ul;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sector_blocks * KUZNYECHIK_BLOCK_SIZE];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sector_blocks * KUZNYECHIK_BLOCK_SIZE] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char range[range_blocks * KUZNYECHIK_BLOCK_SIZE]       = {};
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+    dec_encrypt(enc::partition, enc::partition_counter, enc::sector, enc::sector_counter,
+                plaintext, sector_blocks, enc::primary_key, ciphertext, &cipher);
+
+    KEY sector_key;
+    dec_sector_key(enc::partition, enc::partition_counter, enc::sector, enc::sector_counter,
+                   sector_blocks, &context, &sector_key);
+
+    for (const auto first_block : { 0ul, 5ul, 9ul, sector_blocks - range_blocks })
+    {
+        const auto offset = first_block * KUZNYECHIK_BLOCK_SIZE;
+
+        dec_encrypt_blocks_context(enc::partition, enc::partition_counter, enc::sector, enc::sector_counter,
+                                   sector_blocks, first_block, plaintext + offset, range_blocks, &context, range);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, ciphertext + offset, range,
+                     range_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        dec_decrypt_blocks_context(enc::partition, enc::partition_counter, enc::sector, enc::sector_counter,
+                                   sector_blocks, first_block, ciphertext + offset, range_blocks, &context, range);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext + offset, range,
+                     range_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        dec_decrypt_blocks_perform(enc::sector, enc::sector_counter, sector_blocks, first_block,
+                                   ciphertext + offset, range_blocks, &sector_key, range, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext + offset, range,
+                     range_blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+
+TEST(DecKuznyechik, KeyStore)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data encrypted with keys from the store MUST match data encrypted by `dec_encrypt`
+    // Store MUST keep keys after it is reopened
+    // Store MUST NOT be opened with another master key
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    constexpr auto entries = 4ull;
+    const auto size = dec_key_store_region_size(entries);
+    auto region = test::details::AlignedStorage(size);
+
+    KEY keys[BCMLIB_DEC_KEY_STORE_KEYS];
+
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sizeof(enc::plaintext)];
+
+    const auto encrypt = [&](unsigned long long partition, unsigned long long partition_counter,
+                             DEC_CONTEXT* context) {
+        dec_encrypt(partition, partition_counter, 0, enc::sector_counter,
+                    enc::plaintext, enc::blocks, enc::primary_key, expected, &cipher);
+
+        dec_encrypt_context(partition, partition_counter, 0, enc::sector_counter,
+                            enc::plaintext, enc::blocks, context, ciphertext);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext,
+                     enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+    };
+
+    {
+        DEC_CONTEXT context;
+        dec_context_init(&master_key, 1, &context, &cipher);
+
+        DEC_KEY_STORE store;
+        ASSERT_EQ(dec_key_store_open(region.data(), size, keys, &context, &store), dec_key_store_ok);
+        context.key_store = &store;
+
+        for (unsigned long long partition = 0; partition < 6; ++partition)
+        {
+            encrypt(partition, enc::partition_counter, &context);
+        }
+
+        dec_key_store_close(&store);
+    }
+
+    {
+        DEC_CONTEXT context;
+        dec_context_init(&master_key, 1, &context, &cipher);
+
+        DEC_KEY_STORE store;
+        ASSERT_EQ(dec_key_store_open(region.data(), size, keys, &context, &store), dec_key_store_ok);
+        context.key_store = &store;
+
+        for (unsigned long long partition = 0; partition < 6; ++partition)
+        {
+            encrypt(partition, enc::partition_counter, &context);
+        }
+
+        //
+        // Changed partition counter MUST replace stored key
+        //
+
+        encrypt(1, enc::partition_counter + 1, &context);
+        encrypt(1, enc::partition_counter + 1, &context);
+        encrypt(1, enc::partition_counter, &context);
+
+        //
+        // Corrupted entry MUST NOT be used
+        //
+
+        auto bytes = reinterpret_cast<unsigned char*>(region.data());
+        std::for_each(bytes + dec_key_store_region_size(0), bytes + size, [](unsigned char& byte) {
+            byte ^= 0x5a;
+        });
+
+        encrypt(2, enc::partition_counter, &context);
+
+        dec_key_store_close(&store);
+    }
+
+    {
+        KEY another_master_key;
+        cipher.initialize_encrypt_key(enc::secondary_key, &another_master_key);
+
+        DEC_CONTEXT context;
+        dec_context_init(&another_master_key, 2, &context, &cipher);
+
+        DEC_KEY_STORE store;
+        EXPECT_EQ(dec_key_store_open(region.data(), size, keys, &context, &store), dec_key_store_invalid);
+        EXPECT_EQ(dec_key_store_format(region.data(), size, keys, &context, &store), dec_key_store_ok);
+        EXPECT_EQ(dec_key_store_open(region.data(), size, keys, &context, &store), dec_key_store_ok);
+
+        dec_key_store_close(&store);
+    }
+}
+
+
+TEST(DecKuznyechik, CounterStore)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Allocated counters MUST increase and MUST be visible before commit
+    // Committed counters MUST survive reopening
+    // Commit interrupted after journal is flushed MUST be finished on open
+    // Data encrypted with an allocated counter MUST be decrypted with the stored one
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    KEY master_key;
+    cipher.initialize_encrypt_key(enc::primary_key, &master_key);
+
+    DEC_CONTEXT context;
+    dec_context_init(&master_key, 1, &context, &cipher);
+
+    constexpr auto sectors = 3000ull;
+    const auto size = dec_counter_store_region_size(sectors);
+
+    //
+    // Flush routine saves a copy of the region at the first flush,
+    // which is the flush of journal in commit
+    //
+
+    struct FlushContext
+    {
+        const std::vector<unsigned long long>* region;
+        std::vector<unsigned long long> crashed;
+        unsigned long flushes;
+    };
+
+    std::vector<unsigned long long> region((size + sizeof(unsigned long long) - 1) / sizeof(unsigned long long));
+    FlushContext flush_context = { &region, {}, 0 };
+
+    const auto flush = [](void* user_context, const void*, unsigned long long) {
+        auto context = static_cast<FlushContext*>(user_context);
+
+        if (!context->flushes++)
+        {
+            context->crashed = *context->region;
+        }
+    };
+
+    DEC_COUNTER_STORE store;
+    ASSERT_EQ(dec_counter_store_open(region.data(), size, sectors, nullptr, nullptr, &store), dec_counter_store_ok);
+
+    unsigned long long counter = 0;
+
+    EXPECT_EQ(dec_counter_store_next(&store, 5, &counter), dec_counter_store_ok);
+    EXPECT_EQ(counter, 1ull);
+    EXPECT_EQ(dec_counter_store_next(&store, 5, &counter), dec_counter_store_ok);
+    EXPECT_EQ(counter, 2ull);
+    EXPECT_EQ(dec_counter_store_get(&store, 5, &counter), dec_counter_store_ok);
+    EXPECT_EQ(counter, 2ull);
+    EXPECT_EQ(dec_counter_store_next(&store, sectors, &counter), dec_counter_store_invalid);
+
+    for (unsigned long long sector = 0; sector < BCMLIB_DEC_COUNTER_BATCH_SIZE - 1; ++sector)
+    {
+        EXPECT_EQ(dec_counter_store_next(&store, sectors - 1 - sector * 37, &counter), dec_counter_store_ok);
+    }
+
+    EXPECT_EQ(dec_counter_store_next(&store, 6, &counter), dec_counter_store_batch_full);
+
+    dec_counter_store_commit(&store);
+
+    EXPECT_EQ(dec_counter_store_next(&store, 6, &counter), dec_counter_store_ok);
+    EXPECT_EQ(counter, 1ull);
+
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sizeof(enc::plaintext)];
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sizeof(enc::plaintext)];
+
+    //
+    // Counter is committed before data encrypted with it is written
+    //
+
+    EXPECT_EQ(dec_counter_store_next(&store, 5, &counter), dec_counter_store_ok);
+    EXPECT_EQ(counter, 3ull);
+
+    dec_counter_store_commit(&store);
+
+    const auto written = counter;
+
+    dec_encrypt_context(0, enc::partition_counter, 5, written,
+                        enc::plaintext, enc::blocks, &context, ciphertext);
+
+    //
+    // Store is reopened with the flush routine, the next commit is "interrupted"
+    //
+
+    ASSERT_EQ(dec_counter_store_open(region.data(), size, sectors, flush, &flush_context, &store), dec_counter_store_ok);
+
+    EXPECT_EQ(dec_counter_store_get(&store, 5, &counter), dec_counter_store_ok);
+    EXPECT_EQ(counter, written);
+
+    dec_decrypt_context(0, enc::partition_counter, 5, counter,
+                        ciphertext, enc::blocks, &context, plaintext);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, enc::plaintext, plaintext,
+                 enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    EXPECT_EQ(dec_counter_store_next(&store, 5, &counter), dec_counter_store_ok);
+    EXPECT_GT(counter, written);
+    EXPECT_EQ(dec_counter_store_next(&store, 6, &counter), dec_counter_store_ok);
+    EXPECT_EQ(dec_counter_store_next(&store, 1500, &counter), dec_counter_store_ok);
+
+    dec_counter_store_commit(&store);
+
+    for (auto* image : { &region, &flush_context.crashed })
+    {
+        ASSERT_EQ(dec_counter_store_open(image->data(), size, sectors, nullptr, nullptr, &store), dec_counter_store_ok);
+
+        EXPECT_EQ(dec_counter_store_get(&store, 5, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, written + 1);
+        EXPECT_EQ(dec_counter_store_get(&store, 6, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 2ull);
+        EXPECT_EQ(dec_counter_store_get(&store, 1500, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 1ull);
+        EXPECT_EQ(dec_counter_store_get(&store, sectors - 1, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 1ull);
+
+        //
+        // Counters used for written data are never handed out again
+        //
+
+        EXPECT_EQ(dec_counter_store_next(&store, 5, &counter), dec_counter_store_ok);
+        EXPECT_GT(counter, written + 1);
+    }
+
+    EXPECT_EQ(dec_counter_store_open(region.data(), size, sectors + 1, nullptr, nullptr, &store),
+              dec_counter_store_invalid);
+}
+
+
+TEST(DecKuznyechik, CounterStoreRebase)
+{
+    //
+    // MUST NOT throw any exception
+    // Page MUST be rebased when its counters grow too large
+    // Interrupted rebase MUST be finished on open at any flush
+    // Counters, that do not fit in a page, MUST be rejected
+    //
+
+    constexpr auto sectors = 3000ull;
+    constexpr auto page_sectors = 1020ull;
+    constexpr auto large = 0x80000000ull;
+
+    const auto size = dec_counter_store_region_size(sectors);
+
+    //
+    // Flush routine saves a copy of the region at every flush
+    //
+
+    struct FlushContext
+    {
+        const std::vector<unsigned long long>* region;
+        std::vector<std::vector<unsigned long long>> crashed;
+    };
+
+    std::vector<unsigned long long> region((size + sizeof(unsigned long long) - 1) / sizeof(unsigned long long));
+    FlushContext flush_context = { &region, {} };
+
+    const auto flush = [](void* user_context, const void*, unsigned long long) {
+        auto context = static_cast<FlushContext*>(user_context);
+        context->crashed.push_back(*context->region);
+    };
+
+    DEC_COUNTER_STORE store;
+    ASSERT_EQ(dec_counter_store_format(region.data(), size, sectors, nullptr, nullptr, &store), dec_counter_store_ok);
+
+    for (unsigned long long sector = 0; sector < page_sectors; ++sector)
+    {
+        if (dec_counter_store_set(&store, sector, 1000 + sector) == dec_counter_store_batch_full)
+        {
+            dec_counter_store_commit(&store);
+            ASSERT_EQ(dec_counter_store_set(&store, sector, 1000 + sector), dec_counter_store_ok);
+        }
+    }
+
+    dec_counter_store_commit(&store);
+
+    unsigned long long counter = 0;
+
+    EXPECT_EQ(dec_counter_store_set(&store, 0, 1000), dec_counter_store_invalid);
+    EXPECT_EQ(dec_counter_store_set(&store, 0, 0), dec_counter_store_invalid);
+    EXPECT_EQ(dec_counter_store_set(&store, sectors, 1), dec_counter_store_invalid);
+    EXPECT_EQ(dec_counter_store_set(&store, 1500, 1ull << 33), dec_counter_store_overflow);
+
+    //
+    // Delta of sector 7 reaches the limit, so page is rebased
+    //
+
+    ASSERT_EQ(dec_counter_store_open(region.data(), size, sectors, flush, &flush_context, &store), dec_counter_store_ok);
+    ASSERT_EQ(dec_counter_store_set(&store, 7, large), dec_counter_store_ok);
+
+    dec_counter_store_commit(&store);
+
+    //
+    // Journal, page, spare page, page again and spare checksum
+    //
+
+    EXPECT_GT(flush_context.crashed.size(), 2u);
+
+    auto images = flush_context.crashed;
+    images.push_back(region);
+
+    for (auto& image : images)
+    {
+        ASSERT_EQ(dec_counter_store_open(image.data(), size, sectors, nullptr, nullptr, &store), dec_counter_store_ok);
+
+        EXPECT_EQ(dec_counter_store_get(&store, 7, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, large);
+        EXPECT_EQ(dec_counter_store_get(&store, 0, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 1000ull);
+        EXPECT_EQ(dec_counter_store_get(&store, page_sectors - 1, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 1000 + page_sectors - 1);
+        EXPECT_EQ(dec_counter_store_get(&store, 1500, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 0ull);
+
+        EXPECT_EQ(dec_counter_store_next(&store, 0, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, 1001ull);
+        EXPECT_EQ(dec_counter_store_next(&store, 7, &counter), dec_counter_store_ok);
+        EXPECT_EQ(counter, large + 1);
+
+        //
+        // Base of the page is moved to its smallest counter
+        //
+
+        EXPECT_EQ(dec_counter_store_set(&store, 8, 0xffffffffull + 1000), dec_counter_store_ok);
+        EXPECT_EQ(dec_counter_store_set(&store, 9, 0xffffffffull + 1001), dec_counter_store_overflow);
+    }
+}
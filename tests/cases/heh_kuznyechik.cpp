@@ -21,6 +21,109 @@ BCMLIB_TESTS_ALIGN16 static constexpr unsigned char ciphertext[] = {
 }  // namespace test::data::enc
 
 
+namespace test::reference {
+
+/**
+ * @brief Straightforward HEH: psi, ECB and inverse of psi as separate passes,
+ *        hash is evaluated by Horner's rule with `gf128_multiply`.
+ */
+inline void Heh(unsigned long long tweak, const unsigned char* in, unsigned long long blocks,
+                const unsigned char* key, bool encrypt, unsigned char* out, const BLOCK_CIPHER* cipher)
+{
+    KEY tweak_key;
+    KEY data_key;
+
+    cipher->initialize_encrypt_key(key, &tweak_key);
+
+    if (encrypt)
+    {
+        cipher->initialize_encrypt_key(key, &data_key);
+    }
+    else
+    {
+        cipher->initialize_decrypt_key(key, &data_key);
+    }
+
+    __m128i tau;
+    cipher->encrypt_block(_mm_set_epi64x(0, static_cast<long long>(tweak)), &tweak_key, &tau);
+
+    const auto beta = gf128_multiply_primitive(tau);
+
+    const auto hash = [&](const __m128i* blocks_in) {
+        auto Y = _mm_setzero_si128();
+
+        for (auto block = 0ull; block < blocks - 1; ++block)
+        {
+            Y = gf128_multiply(_mm_xor_si128(Y, blocks_in[block]), tau);
+        }
+
+        return Y;
+    };
+
+    auto storage = test::details::AlignedStorage(blocks * KUZNYECHIK_BLOCK_SIZE);
+    auto data = reinterpret_cast<__m128i*>(storage.data());
+
+    for (auto block = 0ull; block < blocks; ++block)
+    {
+        data[block] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in) + block);
+    }
+
+    //
+    // psi
+    //
+
+    auto Y    = _mm_xor_si128(hash(data), data[blocks - 1]);
+    auto mask = gf128_multiply_primitive(beta);
+
+    for (auto block = 0ull; block < blocks - 1; ++block)
+    {
+        data[block] = _mm_xor_si128(_mm_xor_si128(data[block], Y), mask);
+        mask        = gf128_multiply_primitive(mask);
+    }
+
+    data[blocks - 1] = _mm_xor_si128(Y, beta);
+
+    //
+    // ECB
+    //
+
+    for (auto block = 0ull; block < blocks; ++block)
+    {
+        if (encrypt)
+        {
+            cipher->encrypt_block(data[block], &data_key, &data[block]);
+        }
+        else
+        {
+            cipher->decrypt_block(data[block], &data_key, &data[block]);
+        }
+    }
+
+    //
+    // Inverse of psi
+    //
+
+    mask = gf128_multiply_primitive(beta);
+
+    data[blocks - 1] = _mm_xor_si128(data[blocks - 1], beta);
+
+    for (auto block = 0ull; block < blocks - 1; ++block)
+    {
+        data[block] = _mm_xor_si128(_mm_xor_si128(data[block], mask), data[blocks - 1]);
+        mask        = gf128_multiply_primitive(mask);
+    }
+
+    data[blocks - 1] = _mm_xor_si128(data[blocks - 1], hash(data));
+
+    for (auto block = 0ull; block < blocks; ++block)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out) + block, data[block]);
+    }
+}
+
+}  // namespace test::reference
+
+
 TEST(HehKuznyechik, Encrypt)
 {
     using namespace test::data;
@@ -73,3 +176,152 @@ TEST(HehKuznyechik, Decrypt)
     EXPECT_PRED4(test::details::EqualDataUnits, enc::plaintext,
                  plaintext, enc::blocks, KUZNYECHIK_BLOCK_SIZE);
 }
+
+
+TEST(HehKuznyechik, EncryptDecryptHash)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data units of any length MUST be processed as by a straightforward
+    // implementation (lengths cover several windows of aggregated hash and
+    // partial ones)
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    for (auto unit_blocks : { 2ul, 8ul, 9ul, 10ul, 17ul, 19ul })
+    {
+        const auto unit_size = unit_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+        auto plaintext = test::details::AlignedStorage(unit_size);
+        auto expected = test::details::AlignedStorage(unit_size);
+        auto ciphertext = test::details::AlignedStorage(unit_size);
+        auto decrypted = test::details::AlignedStorage(unit_size);
+
+        auto plaintext_bytes = plaintext.front().bytes;
+        std::iota(plaintext_bytes, plaintext_bytes + unit_size, static_cast<unsigned char>(unit_blocks));
+
+        test::reference::Heh(enc::tweak, plaintext_bytes, unit_blocks, enc::primary_key,
+                             true, expected.front().bytes, &cipher);
+
+        heh_encrypt(enc::tweak, plaintext_bytes, unit_blocks, enc::primary_key, ciphertext.front().bytes, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected.front().bytes, ciphertext.front().bytes,
+                     unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        test::reference::Heh(enc::tweak, ciphertext.front().bytes, unit_blocks, enc::primary_key,
+                             false, expected.front().bytes, &cipher);
+
+        heh_decrypt(enc::tweak, ciphertext.front().bytes, unit_blocks, enc::primary_key, decrypted.front().bytes, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected.front().bytes, decrypted.front().bytes,
+                     unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext_bytes, decrypted.front().bytes,
+                     unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+
+TEST(HehKuznyechik, EncryptDecryptLarge)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Large data unit MUST be encrypted (decrypted) as by a straightforward implementation
+    // Decrypted large data unit MUST match an original one
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto unit_blocks = 4096ul + 7ul;
+    constexpr auto unit_size   = unit_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    std::vector<unsigned char> plaintext(unit_size);
+    std::vector<unsigned char> expected(unit_size);
+    std::vector<unsigned char> ciphertext(unit_size);
+    std::vector<unsigned char> decrypted(unit_size);
+
+    std::iota(plaintext.begin(), plaintext.end(), static_cast<unsigned char>(0));
+
+    test::reference::Heh(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key, true, expected.data(), &cipher);
+
+    heh_encrypt_large(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key, ciphertext.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, expected.data(), ciphertext.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    test::reference::Heh(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key, false, expected.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), expected.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    heh_decrypt_large(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key, decrypted.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), decrypted.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    //
+    // In-place decryption
+    //
+
+    heh_decrypt_large(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key, ciphertext.data(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), ciphertext.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+}
+
+
+TEST(HehKuznyechik, EncryptDecryptSectors)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Each encrypted (decrypted) sector MUST match a sector encrypted (decrypted) separately
+    // by a straightforward implementation
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto sectors       = 11ul;
+    constexpr auto sector_blocks = 13ul;
+    constexpr auto sector_size   = sector_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sectors * sector_size];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sectors * sector_size] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char decrypted[sectors * sector_size]  = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sector_size]             = {};
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+    heh_encrypt_sectors(enc::tweak, sectors, plaintext, sector_blocks,
+                        enc::primary_key, ciphertext, &cipher);
+
+    heh_decrypt_sectors(enc::tweak, sectors, ciphertext, sector_blocks,
+                        enc::primary_key, decrypted, &cipher);
+
+    for (auto sector = 0ul; sector < sectors; ++sector)
+    {
+        test::reference::Heh(enc::tweak + sector, plaintext + sector * sector_size, sector_blocks,
+                             enc::primary_key, true, expected, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext + sector * sector_size,
+                     sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        heh_encrypt(enc::tweak + sector, plaintext + sector * sector_size, sector_blocks,
+                    enc::primary_key, expected, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext + sector * sector_size,
+                     sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext + sector * sector_size,
+                     decrypted + sector * sector_size, sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
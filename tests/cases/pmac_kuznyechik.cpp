@@ -0,0 +1,240 @@
+/**
+ * @file pmac_kuznyechik.cpp
+ * @brief Test cases for Kuznyechik in PMAC mode of operation.
+ */
+
+#include "test_common.hpp"
+
+#include <array>
+
+
+namespace test::reference {
+
+/**
+ * @brief 128-bit block as a big-endian byte string.
+ */
+using PmacBlock = std::array<unsigned char, 16>;
+
+
+/**
+ * @brief Multiplies a block by x (left shift with reduction by x^7 + x^2 + x + 1).
+ */
+inline PmacBlock PmacDouble(PmacBlock block)
+{
+    const auto msb = block[0] >> 7;
+
+    for (auto idx = 0ul; idx < block.size() - 1; ++idx)
+    {
+        block[idx] = static_cast<unsigned char>((block[idx] << 1) | (block[idx + 1] >> 7));
+    }
+
+    block[15] = static_cast<unsigned char>((block[15] << 1) ^ (msb ? 0x87 : 0x00));
+
+    return block;
+}
+
+
+/**
+ * @brief Multiplies a block by x^(-1) (right shift, adds 10...01000011 if LSB was set).
+ */
+inline PmacBlock PmacHalf(PmacBlock block)
+{
+    const auto lsb = block[15] & 1;
+
+    for (auto idx = block.size() - 1; idx > 0; --idx)
+    {
+        block[idx] = static_cast<unsigned char>((block[idx] >> 1) | (block[idx - 1] << 7));
+    }
+
+    block[0] = static_cast<unsigned char>(block[0] >> 1);
+
+    if (lsb)
+    {
+        block[0] ^= 0x80;
+        block[15] ^= 0x43;
+    }
+
+    return block;
+}
+
+
+/**
+ * @brief Straightforward PMAC1 of complete blocks with a full 128-bit tag:
+ *        offsets are updated block by block with L(ntz(i)) = L * x^ntz(i).
+ */
+inline PmacBlock Pmac(const unsigned char* in, unsigned long blocks, const unsigned char* key,
+                      const BLOCK_CIPHER* cipher)
+{
+    KEY internal_key;
+    cipher->initialize_encrypt_key(key, &internal_key);
+
+    const auto encrypt = [&](PmacBlock block) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.data()));
+        cipher->encrypt_block(value, &internal_key, &value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(block.data()), value);
+
+        return block;
+    };
+
+    const auto xor_into = [](PmacBlock& to, const unsigned char* from) {
+        for (auto idx = 0ul; idx < to.size(); ++idx)
+        {
+            to[idx] ^= from[idx];
+        }
+    };
+
+    const auto L = encrypt(PmacBlock{});
+
+    PmacBlock offset = {};
+    PmacBlock sum    = {};
+
+    for (auto index = 1ul; index < blocks; ++index)
+    {
+        auto level = L;
+
+        for (auto bits = index; !(bits & 1); bits >>= 1)
+        {
+            level = PmacDouble(level);
+        }
+
+        xor_into(offset, level.data());
+
+        auto block = offset;
+        xor_into(block, in + (index - 1) * KUZNYECHIK_BLOCK_SIZE);
+        xor_into(sum, encrypt(block).data());
+    }
+
+    xor_into(sum, in + (blocks - 1) * KUZNYECHIK_BLOCK_SIZE);
+    xor_into(sum, PmacHalf(L).data());
+
+    return encrypt(sum);
+}
+
+}  // namespace test::reference
+
+
+TEST(PmacKuznyechik, DigestVerify)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Tag MUST be verified successfully
+    // Truncated tag MUST have zero upper half
+    // Tag MUST NOT be verified after any block is changed or blocks are swapped
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    BCMLIB_TESTS_ALIGN16 unsigned char data[sizeof(mac::data)];
+    std::copy(std::begin(mac::data), std::end(mac::data), std::begin(data));
+
+    unsigned char digest[KUZNYECHIK_BLOCK_SIZE] = {};
+    const unsigned char zeros[KUZNYECHIK_BLOCK_SIZE / 2] = {};
+
+    pmac_digest(data, mac::blocks, mac::key, BCMLIB_PMAC_TAG_SIZE_64, digest, &cipher);
+
+    EXPECT_PRED3(test::details::EqualBlocks, digest + KUZNYECHIK_BLOCK_SIZE / 2, zeros,
+                 KUZNYECHIK_BLOCK_SIZE / 2);
+
+    EXPECT_EQ(pmac_verify(data, mac::blocks, mac::key, digest, BCMLIB_PMAC_TAG_SIZE_64, &cipher), pmac_valid);
+
+    for (unsigned long offset = 0; offset < sizeof(data); offset += KUZNYECHIK_BLOCK_SIZE)
+    {
+        data[offset] ^= 0x01;
+
+        EXPECT_EQ(pmac_verify(data, mac::blocks, mac::key, digest, BCMLIB_PMAC_TAG_SIZE_64, &cipher), pmac_invalid);
+
+        data[offset] ^= 0x01;
+    }
+
+    std::swap_ranges(data, data + KUZNYECHIK_BLOCK_SIZE, data + KUZNYECHIK_BLOCK_SIZE);
+
+    EXPECT_EQ(pmac_verify(data, mac::blocks, mac::key, digest, BCMLIB_PMAC_TAG_SIZE_64, &cipher), pmac_invalid);
+}
+
+
+TEST(PmacKuznyechik, DigestReference)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Tag MUST match a tag computed by a straightforward implementation
+    // (sizes cover several offset levels and partial windows)
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    //
+    // The first 32 bytes of MAC data are used as the second key: its
+    // L = Encrypt(K, 0...0) is odd, so reduction in L * x^(-1) is covered
+    //
+
+    for (const auto key : { mac::key, mac::data })
+    {
+        for (const auto blocks : { 1ul, 2ul, 3ul, 4ul, 8ul, 9ul, 17ul, 33ul })
+        {
+            std::vector<unsigned char> data(blocks * KUZNYECHIK_BLOCK_SIZE);
+            std::iota(data.begin(), data.end(), static_cast<unsigned char>(blocks));
+
+            unsigned char digest[KUZNYECHIK_BLOCK_SIZE] = {};
+
+            const auto expected = test::reference::Pmac(data.data(), blocks, key, &cipher);
+
+            pmac_digest(data.data(), blocks, key, BCMLIB_PMAC_TAG_SIZE_128, digest, &cipher);
+
+            EXPECT_PRED3(test::details::EqualBlocks, expected.data(), digest, KUZNYECHIK_BLOCK_SIZE);
+        }
+    }
+}
+
+
+TEST(PmacKuznyechik, DigestParallel)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Tag computed in parallel MUST match one computed in a single thread
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr unsigned long sizes[] = { 1, 2, 9, 100, 1000, 1025 };
+
+    test::details::ThreadExecutor executor(3);
+
+    for (const auto blocks : sizes)
+    {
+        std::vector<unsigned char> data(blocks * KUZNYECHIK_BLOCK_SIZE);
+        std::iota(data.begin(), data.end(), static_cast<unsigned char>(blocks));
+
+        unsigned char expected[KUZNYECHIK_BLOCK_SIZE] = {};
+        unsigned char digest[KUZNYECHIK_BLOCK_SIZE] = {};
+
+        pmac_digest(data.data(), blocks, mac::key, BCMLIB_PMAC_TAG_SIZE_128, expected, &cipher);
+
+        for (const auto min_chunk_blocks : { 1ul, 64ul })
+        {
+            pmac_digest_parallel(data.data(), blocks, mac::key, BCMLIB_PMAC_TAG_SIZE_128, digest,
+                                 min_chunk_blocks, executor.Get(), &cipher);
+
+            EXPECT_PRED3(test::details::EqualBlocks, expected, digest, KUZNYECHIK_BLOCK_SIZE);
+        }
+
+        pmac_digest_parallel(data.data(), blocks, mac::key, BCMLIB_PMAC_TAG_SIZE_128, digest,
+                             1, nullptr, &cipher);
+
+        EXPECT_PRED3(test::details::EqualBlocks, expected, digest, KUZNYECHIK_BLOCK_SIZE);
+    }
+
+    //
+    // Large messages MUST be actually split between tasks
+    //
+
+    EXPECT_GT(executor.Runs(), 0ul);
+}
@@ -73,3 +73,274 @@ TEST(XtsKuznyechik, Decrypt)
     EXPECT_PRED4(test::details::EqualDataUnits, enc::plaintext,
                  plaintext, enc::blocks, KUZNYECHIK_BLOCK_SIZE);
 }
+
+
+TEST(XtsKuznyechik, EncryptDecryptSector)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Prefix of encrypted sector MUST match an expected test vector
+    // (XTS encrypts each block independently)
+    // Decrypted sector MUST match an original one
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto sector_blocks = 32ul;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sector_blocks * KUZNYECHIK_BLOCK_SIZE];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sector_blocks * KUZNYECHIK_BLOCK_SIZE] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char decrypted[sector_blocks * KUZNYECHIK_BLOCK_SIZE]  = {};
+
+    std::fill(std::begin(plaintext), std::end(plaintext), enc::plaintext[0]);
+
+    xts_encrypt(enc::tweak, plaintext, sector_blocks, enc::primary_key,
+                enc::secondary_key, ciphertext, &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, enc::ciphertext,
+                 ciphertext, enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    xts_decrypt(enc::tweak, ciphertext, sector_blocks, enc::primary_key,
+                enc::secondary_key, decrypted, &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext,
+                 decrypted, sector_blocks, KUZNYECHIK_BLOCK_SIZE);
+}
+
+
+TEST(XtsKuznyechik, EncryptDecryptSectors)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Each encrypted sector MUST match a sector encrypted separately
+    // Decrypted sectors MUST match original ones
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto sectors     = 11ul;
+    constexpr auto sector_size = enc::blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sectors * sector_size];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sectors * sector_size] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[sector_size]             = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char decrypted[sectors * sector_size]  = {};
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+    xts_encrypt_sectors(enc::tweak, sectors, plaintext, enc::blocks, enc::primary_key,
+                        enc::secondary_key, ciphertext, &cipher);
+
+    for (auto sector = 0ul; sector < sectors; ++sector)
+    {
+        xts_encrypt(enc::tweak + sector, plaintext + sector * sector_size, enc::blocks,
+                    enc::primary_key, enc::secondary_key, expected, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, ciphertext + sector * sector_size,
+                     enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+
+    xts_decrypt_sectors(enc::tweak, sectors, ciphertext, enc::blocks, enc::primary_key,
+                        enc::secondary_key, decrypted, &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext, decrypted,
+                 sectors * enc::blocks, KUZNYECHIK_BLOCK_SIZE);
+}
+
+
+TEST(XtsKuznyechik, EncryptDecryptBlocks)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Encrypted range MUST match the same range of encrypted sector
+    // Decrypted range MUST match the same range of original sector
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto sector_blocks = 160ul;
+    constexpr auto range_blocks  = 4ul;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[sector_blocks * KUZNYECHIK_BLOCK_SIZE];
+    BCMLIB_TESTS_ALIGN16 unsigned char ciphertext[sector_blocks * KUZNYECHIK_BLOCK_SIZE] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char range[range_blocks * KUZNYECHIK_BLOCK_SIZE]       = {};
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+    xts_encrypt(enc::tweak, plaintext, sector_blocks, enc::primary_key,
+                enc::secondary_key, ciphertext, &cipher);
+
+    //
+    // Check ranges at the beginning, in the middle and beyond 128th
+    // block (the latter requires reduction of tweak multiplier)
+    //
+
+    for (const auto first_block : { 0ul, 5ul, 127ul, 130ul, sector_blocks - range_blocks })
+    {
+        const auto offset = first_block * KUZNYECHIK_BLOCK_SIZE;
+
+        xts_encrypt_blocks(enc::tweak, first_block, plaintext + offset, range_blocks,
+                           enc::primary_key, enc::secondary_key, range, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, ciphertext + offset, range,
+                     range_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+        xts_decrypt_blocks(enc::tweak, first_block, ciphertext + offset, range_blocks,
+                           enc::primary_key, enc::secondary_key, range, &cipher);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, plaintext + offset, range,
+                     range_blocks, KUZNYECHIK_BLOCK_SIZE);
+    }
+}
+
+
+TEST(XtsKuznyechik, EncryptDecryptParallel)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Data unit encrypted in parallel MUST match one encrypted in a single thread
+    // Data unit decrypted in parallel MUST match an original one
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto unit_blocks = 1000ul;
+    constexpr auto unit_size   = unit_blocks * KUZNYECHIK_BLOCK_SIZE;
+
+    std::vector<unsigned char> plaintext(unit_size);
+    std::vector<unsigned char> expected(unit_size);
+    std::vector<unsigned char> ciphertext(unit_size);
+    std::vector<unsigned char> decrypted(unit_size);
+
+    std::iota(plaintext.begin(), plaintext.end(), static_cast<unsigned char>(0));
+
+    xts_encrypt(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key,
+                enc::secondary_key, expected.data(), &cipher);
+
+    test::details::ThreadExecutor executor(3);
+
+    xts_encrypt_parallel(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key,
+                         enc::secondary_key, ciphertext.data(), 64, executor.Get(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, expected.data(), ciphertext.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    xts_decrypt_parallel(enc::tweak, ciphertext.data(), unit_blocks, enc::primary_key,
+                         enc::secondary_key, decrypted.data(), 64, executor.Get(), &cipher);
+
+    EXPECT_PRED4(test::details::EqualDataUnits, plaintext.data(), decrypted.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+
+    //
+    // Small data unit MUST NOT be split
+    //
+
+    xts_encrypt_parallel(enc::tweak, plaintext.data(), unit_blocks, enc::primary_key,
+                         enc::secondary_key, ciphertext.data(), unit_blocks, executor.Get(), &cipher);
+
+    EXPECT_EQ(executor.Runs(), 2ul);
+    EXPECT_PRED4(test::details::EqualDataUnits, expected.data(), ciphertext.data(),
+                 unit_blocks, KUZNYECHIK_BLOCK_SIZE);
+}
+
+
+TEST(XtsKuznyechik, EncryptDecryptBytes)
+{
+    using namespace test::data;
+
+    //
+    // MUST NOT throw any exception
+    // Complete blocks except the last one MUST match ordinary XTS ciphertext
+    // Stolen tail MUST match the head of ordinary ciphertext of the last complete block
+    // The last complete block MUST match ordinary ciphertext of padded incomplete block
+    // with the next tweak
+    // Decryption performed in place MUST recover an original data
+    // Data units shorter than a block MUST be left untouched
+    //
+
+    BLOCK_CIPHER cipher = {};
+    kuznyechik_initialize_interface(&cipher);
+
+    constexpr auto unit_blocks = 11ul;
+
+    BCMLIB_TESTS_ALIGN16 unsigned char plaintext[(unit_blocks + 1) * KUZNYECHIK_BLOCK_SIZE];
+    BCMLIB_TESTS_ALIGN16 unsigned char expected[unit_blocks * KUZNYECHIK_BLOCK_SIZE] = {};
+    BCMLIB_TESTS_ALIGN16 unsigned char data[(unit_blocks + 1) * KUZNYECHIK_BLOCK_SIZE];
+    BCMLIB_TESTS_ALIGN16 unsigned char padded[(unit_blocks + 1) * KUZNYECHIK_BLOCK_SIZE];
+    BCMLIB_TESTS_ALIGN16 unsigned char stolen[(unit_blocks + 1) * KUZNYECHIK_BLOCK_SIZE];
+
+    std::iota(std::begin(plaintext), std::end(plaintext), static_cast<unsigned char>(0));
+
+    xts_encrypt(enc::tweak, plaintext, unit_blocks, enc::primary_key,
+                enc::secondary_key, expected, &cipher);
+
+    for (const auto remainder : { 0ul, 1ul, 7ul, 15ul })
+    {
+        const auto size = unit_blocks * KUZNYECHIK_BLOCK_SIZE + remainder;
+        std::copy(std::begin(plaintext), std::end(plaintext), std::begin(data));
+
+        ASSERT_EQ(xts_encrypt_bytes(enc::tweak, data, size, enc::primary_key,
+                                    enc::secondary_key, data, &cipher),
+                  xts_result::xts_ok);
+
+        EXPECT_PRED4(test::details::EqualDataUnits, expected, data,
+                     unit_blocks - 1, KUZNYECHIK_BLOCK_SIZE);
+
+        EXPECT_PRED3(test::details::EqualBlocks, expected + (unit_blocks - 1) * KUZNYECHIK_BLOCK_SIZE,
+                     data + (unit_blocks - 1 + (remainder ? 1 : 0)) * KUZNYECHIK_BLOCK_SIZE,
+                     remainder ? remainder : KUZNYECHIK_BLOCK_SIZE);
+
+        EXPECT_EQ(data[size], plaintext[size]);
+
+        if (remainder)
+        {
+            //
+            // PP = P[m] || CC[r..), C[m - 1] = Enc(PP, T[m]), that is an ordinary
+            // XTS ciphertext of PP placed right after the complete blocks
+            //
+
+            std::copy(std::begin(plaintext), std::end(plaintext), std::begin(padded));
+            std::copy(expected + (unit_blocks - 1) * KUZNYECHIK_BLOCK_SIZE + remainder,
+                      expected + unit_blocks * KUZNYECHIK_BLOCK_SIZE,
+                      padded + unit_blocks * KUZNYECHIK_BLOCK_SIZE + remainder);
+
+            xts_encrypt(enc::tweak, padded, unit_blocks + 1, enc::primary_key,
+                        enc::secondary_key, stolen, &cipher);
+
+            EXPECT_PRED3(test::details::EqualBlocks, stolen + unit_blocks * KUZNYECHIK_BLOCK_SIZE,
+                         data + (unit_blocks - 1) * KUZNYECHIK_BLOCK_SIZE, KUZNYECHIK_BLOCK_SIZE);
+        }
+
+        ASSERT_EQ(xts_decrypt_bytes(enc::tweak, data, size, enc::primary_key,
+                                    enc::secondary_key, data, &cipher),
+                  xts_result::xts_ok);
+
+        EXPECT_PRED3(test::details::EqualBlocks, plaintext, data, size);
+    }
+
+    std::copy(std::begin(plaintext), std::end(plaintext), std::begin(data));
+
+    EXPECT_EQ(xts_encrypt_bytes(enc::tweak, data, KUZNYECHIK_BLOCK_SIZE - 1, enc::primary_key,
+                                enc::secondary_key, data, &cipher),
+              xts_result::xts_invalid_length);
+
+    EXPECT_PRED3(test::details::EqualBlocks, plaintext, data, sizeof(data));
+
+    EXPECT_EQ(xts_decrypt_bytes(enc::tweak, data, KUZNYECHIK_BLOCK_SIZE - 1, enc::primary_key,
+                                enc::secondary_key, data, &cipher),
+              xts_result::xts_invalid_length);
+
+    EXPECT_PRED3(test::details::EqualBlocks, plaintext, data, sizeof(data));
+}
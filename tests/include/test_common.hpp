@@ -6,6 +6,15 @@
 #pragma once
 
 
+//
+// Standard library
+//
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+
 //
 // Google tests library
 //
@@ -19,6 +28,7 @@
 
 #include "bclib.h"
 #include "bcmlib.h"
+#include "galoislib.h"
 
 
 //
@@ -27,3 +37,4 @@
 
 #include "test_utils.hpp"
 #include "test_data.hpp"
+#include "test_executor.hpp"
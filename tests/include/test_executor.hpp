@@ -0,0 +1,54 @@
+/**
+ * @file test_executor.hpp
+ * @brief Executor for tests, that runs tasks on standard threads.
+ */
+
+#pragma once
+
+#include <thread>
+#include <vector>
+
+#include "bcmlib.h"
+
+
+namespace test::details {
+
+/**
+ * @brief Executor, that runs each task in a separate thread.
+ */
+class ThreadExecutor
+{
+public:
+    explicit ThreadExecutor(unsigned long concurrency)
+        : executor_ { concurrency, this, Run }
+    { }
+
+    const BCMLIB_EXECUTOR* Get() const noexcept { return &executor_; }
+
+    unsigned long Runs() const noexcept { return runs_; }
+
+private:
+    static void Run(void* user_context, bcmlib_task_routine routine, void* context, unsigned long tasks)
+    {
+        auto self = static_cast<ThreadExecutor*>(user_context);
+        std::vector<std::thread> threads;
+
+        for (unsigned long task = 0; task < tasks; ++task)
+        {
+            threads.emplace_back(routine, context, task);
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        ++self->runs_;
+    }
+
+private:
+    BCMLIB_EXECUTOR executor_;
+    unsigned long runs_ = 0;
+};
+
+}  // namespace test::details
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <cstddef>
+#include <vector>
 
 
 //
@@ -23,6 +24,24 @@
 
 namespace test::details {
 
+/**
+ * @brief 128-bit block, that can be stored in standard containers.
+ */
+struct alignas(16) Block
+{
+    unsigned char bytes[16];
+};
+
+
+/**
+ * @brief Allocates zero-filled 16-byte aligned storage of at least `size` bytes.
+ */
+inline std::vector<Block> AlignedStorage(std::size_t size)
+{
+    return std::vector<Block>((size + sizeof(Block) - 1) / sizeof(Block));
+}
+
+
 /**
  * @brief Test blocks for equality.
  */